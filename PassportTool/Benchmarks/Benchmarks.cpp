@@ -0,0 +1,578 @@
+// PassportTool CPU-stage benchmarks.
+//
+//   passport_bench [--filter=substr] [--out=file.json] [--min-time=seconds]
+//
+// Prints one JSON document: ns/op, MP/s (for pixel stages) and the peak heap
+// growth while each case ran, plus process peak RSS where available.
+
+#include "BackgroundReplacer.h"
+#include "ColorManagement.h"
+#include "FaceDetector.h"
+#include "Layout.h"
+#include "PixelBuffer.h"
+#include "ParallelFor.h"
+#include "PixelCache.h"
+#include "Raster.h"
+#include "Sharpen.h"
+#include "SheetCompositor.h"
+#include "TaskScheduler.h"
+#include "TiltEstimator.h"
+#include "Trace.h"
+#include "Transform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef PT_BENCH_HAVE_PNG
+#include <png.h>
+#endif
+#ifdef PT_BENCH_HAVE_JPEG
+#include <jpeglib.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace PassportTool::Core;
+
+// ──────────────────────────────────────────────────────────────
+// Heap accounting (peak bytes per case)
+// ──────────────────────────────────────────────────────────────
+
+namespace
+{
+    std::atomic<size_t> g_live{ 0 };
+    std::atomic<size_t> g_peak{ 0 };
+    constexpr size_t kHeader = alignof(std::max_align_t);
+
+    void* TrackedAlloc(size_t n)
+    {
+        void* raw = std::malloc(n + kHeader);
+        if (!raw) throw std::bad_alloc();
+        *static_cast<size_t*>(raw) = n;
+        size_t live = g_live.fetch_add(n) + n;
+        size_t peak = g_peak.load();
+        while (live > peak && !g_peak.compare_exchange_weak(peak, live)) {}
+        return static_cast<char*>(raw) + kHeader;
+    }
+
+    void TrackedFree(void* p)
+    {
+        if (!p) return;
+        void* raw = static_cast<char*>(p) - kHeader;
+        g_live.fetch_sub(*static_cast<size_t*>(raw));
+        std::free(raw);
+    }
+}
+
+void* operator new(size_t n) { return TrackedAlloc(n); }
+void* operator new[](size_t n) { return TrackedAlloc(n); }
+void operator delete(void* p) noexcept { TrackedFree(p); }
+void operator delete[](void* p) noexcept { TrackedFree(p); }
+void operator delete(void* p, size_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { TrackedFree(p); }
+
+namespace
+{
+    // ──────────────────────────────────────────────────────────────
+    // Harness
+    // ──────────────────────────────────────────────────────────────
+
+    struct Options
+    {
+        std::string filter;
+        std::string out;
+        double minTime{ 0.25 };
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::string params;
+        long iterations{ 0 };
+        double nsPerOp{ 0 };
+        double mpPerSec{ 0 };      // 0 = not a pixel stage
+        size_t peakBytes{ 0 };
+    };
+
+    volatile uintptr_t g_sink;
+    template <typename T> void Keep(const T& v) { g_sink = reinterpret_cast<uintptr_t>(&v); }
+
+    template <typename Fn>
+    void Bench(std::vector<Result>& results, const Options& opt, const std::string& name,
+        const std::string& params, double megapixels, Fn&& fn)
+    {
+        if (!opt.filter.empty() && (name + " " + params).find(opt.filter) == std::string::npos) return;
+
+        fn();   // warm-up: page in buffers, fill caches
+
+        size_t baseline = g_live.load();
+        g_peak.store(baseline);
+        long iters = 0;
+        long batch = 1;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do
+        {
+            // Batches grow while they are short, so the clock read does not
+            // dominate nanosecond-scale cases.
+            for (long i = 0; i < batch; ++i) fn();
+            iters += batch;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed < opt.minTime / 100 && batch < 4096) batch *= 2;
+        } while (elapsed < opt.minTime && iters < 1000000);
+
+        Result r;
+        r.name = name;
+        r.params = params;
+        r.iterations = iters;
+        r.nsPerOp = elapsed * 1e9 / iters;
+        r.mpPerSec = megapixels > 0 ? megapixels * iters / elapsed : 0.0;
+        r.peakBytes = g_peak.load() - baseline;
+        results.push_back(r);
+        std::fprintf(stderr, "%-16s %-40s %12.0f ns/op\n", name.c_str(), params.c_str(), r.nsPerOp);
+    }
+
+    std::string Num(double v)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%g", v);
+        return buf;
+    }
+
+    std::string Dim(double a, double b) { return Num(a) + "x" + Num(b); }
+
+    // Deterministic portrait-like test image: graded backdrop, skin-toned
+    // head ellipse, darker eyes and shoulders, and a little noise.
+    PixelBuffer MakePortrait(int w, int h)
+    {
+        PixelBuffer p(w, h);
+        uint32_t seed = 12345;
+        for (int y = 0; y < h; ++y)
+        {
+            uint8_t* row = p.Row(y);
+            for (int x = 0; x < w; ++x)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                int n = static_cast<int>((seed >> 28) & 7) - 3;
+                double dx = (x - w * 0.5) / (w * 0.17), dy = (y - h * 0.42) / (h * 0.28);
+                int b = 200 + y * 30 / h, g = 205 + y * 20 / h, r = 210;
+                if (dx * dx + dy * dy < 1.0) { b = 120; g = 150; r = 205; }
+                for (int e = -1; e <= 1; e += 2)
+                {
+                    double ex = (x - (w * 0.5 + e * w * 0.07)) / (w * 0.025);
+                    double ey = (y - h * 0.37) / (h * 0.015);
+                    if (ex * ex + ey * ey < 1.0) { b = 40; g = 40; r = 50; }
+                }
+                if (y > h * 0.78 && std::abs(x - w * 0.5) < w * 0.38) { b = 70; g = 50; r = 40; }
+                uint8_t* q = row + x * 4;
+                q[0] = static_cast<uint8_t>(std::clamp(b + n, 0, 255));
+                q[1] = static_cast<uint8_t>(std::clamp(g + n, 0, 255));
+                q[2] = static_cast<uint8_t>(std::clamp(r + n, 0, 255));
+                q[3] = 255;
+            }
+        }
+        return p;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Encoders (stand-ins for WIC)
+    // ──────────────────────────────────────────────────────────────
+
+#ifdef PT_BENCH_HAVE_PNG
+    std::vector<uint8_t> EncodePng(const PixelBuffer& img)
+    {
+        std::vector<uint8_t> out;
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        png_infop info = png_create_info_struct(png);
+        if (setjmp(png_jmpbuf(png))) { png_destroy_write_struct(&png, &info); return {}; }
+        png_set_write_fn(png, &out, [](png_structp p, png_bytep d, png_size_t n) {
+            auto* v = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(p));
+            v->insert(v->end(), d, d + n);
+            }, nullptr);
+        png_set_IHDR(png, info, img.width, img.height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+            PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_set_bgr(png);
+        png_write_info(png, info);
+        for (int y = 0; y < img.height; ++y)
+            png_write_row(png, const_cast<png_bytep>(img.Row(y)));
+        png_write_end(png, nullptr);
+        png_destroy_write_struct(&png, &info);
+        return out;
+    }
+#endif
+
+#ifdef PT_BENCH_HAVE_JPEG
+    std::vector<uint8_t> EncodeJpeg(const PixelBuffer& img, int quality)
+    {
+        jpeg_compress_struct c{};
+        jpeg_error_mgr err{};
+        c.err = jpeg_std_error(&err);
+        jpeg_create_compress(&c);
+        unsigned char* mem = nullptr;
+        unsigned long size = 0;
+        jpeg_mem_dest(&c, &mem, &size);
+        c.image_width = img.width;
+        c.image_height = img.height;
+        c.input_components = 3;
+        c.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&c);
+        jpeg_set_quality(&c, quality, TRUE);
+        jpeg_start_compress(&c, TRUE);
+        std::vector<uint8_t> rgb(static_cast<size_t>(img.width) * 3);
+        while (c.next_scanline < c.image_height)
+        {
+            const uint8_t* s = img.Row(static_cast<int>(c.next_scanline));
+            for (int x = 0; x < img.width; ++x)
+            {
+                rgb[x * 3 + 0] = s[x * 4 + 2];
+                rgb[x * 3 + 1] = s[x * 4 + 1];
+                rgb[x * 3 + 2] = s[x * 4 + 0];
+            }
+            JSAMPROW row = rgb.data();
+            jpeg_write_scanlines(&c, &row, 1);
+        }
+        jpeg_finish_compress(&c);
+        std::vector<uint8_t> out(mem, mem + size);
+        jpeg_destroy_compress(&c);
+        std::free(mem);
+        return out;
+    }
+#endif
+
+    // ──────────────────────────────────────────────────────────────
+    // Suites
+    // ──────────────────────────────────────────────────────────────
+
+    constexpr double kPpu = 300.0;   // inches at the default 300 DPI
+
+    void LayoutSuite(std::vector<Result>& res, const Options& opt)
+    {
+        const double sheets[][2] = { { 6, 4 }, { 7, 5 }, { 10, 8 }, { 19, 13 }, { 100, 100 } };
+        const double stamps[][2] = { { 2, 2 }, { 1.378, 1.772 }, { 0.1, 0.1 }, { 0.1, 0.15 } };
+        const double gaps[] = { 0.0, 0.05 };
+        for (auto& s : sheets)
+            for (auto& st : stamps)
+                for (double g : gaps)
+                {
+                    std::string params = "sheet=" + Dim(s[0], s[1]) + " stamp=" + Dim(st[0], st[1]) + " gap=" + Num(g);
+                    Bench(res, opt, "layout", params, 0.0, [&] {
+                        auto r = CalculateOptimalPlacement(s[0], s[1], st[0], st[1], g, kPpu);
+                        Keep(r);
+                        });
+                }
+    }
+
+    void PixelSuite(std::vector<Result>& res, const Options& opt)
+    {
+        const PixelBuffer photo = MakePortrait(4000, 3000);
+        const double photoMp = 12.0;
+
+        for (int n : { 600, 1200 })
+        {
+            PixelBuffer stamp = MakePortrait(n, n);
+            double mp = n * n / 1e6;
+            std::string params = Dim(n, n);
+            Bench(res, opt, "rotate90", params, mp, [&] { auto r = Rotate90(stamp); Keep(r); });
+
+            // Stand-in: the app captures the crop with RenderTargetBitmap;
+            // ResampleCrop is the portable equivalent of that render.
+            CropTransform crop{ 0.25, 300, 80, 3.5, 600, 600 };
+            Bench(res, opt, "crop_resample", "stand-in src=4000x3000 out=" + params, mp,
+                [&] { auto r = ResampleCrop(photo, crop, n, n); Keep(r); });
+
+            Bench(res, opt, "sharpen_matte", params, mp, [&] {
+                PixelBuffer c = stamp;
+                SharpenForPrint(c, PrintMedia::Matte, n / 2.0);
+                Keep(c);
+                });
+            Bench(res, opt, "background", params, mp, [&] {
+                PixelBuffer c = stamp;
+                ReplaceBackground(c);
+                Keep(c);
+                });
+        }
+        {
+            // Whole image set at once: one image per worker versus
+            // ReplaceBackground's row parallelism one image at a time.
+            const std::vector<PixelBuffer> set(8, MakePortrait(600, 600));
+            Bench(res, opt, "background_batch", "images=8 600x600", 8 * 0.36, [&] {
+                auto c = set;
+                ReplaceBackgroundBatch(c);
+                Keep(c);
+                });
+            Bench(res, opt, "background", "images=8 600x600 one-by-one", 8 * 0.36, [&] {
+                auto c = set;
+                for (auto& img : c) ReplaceBackground(img);
+                Keep(c);
+                });
+        }
+        {
+            PixelBuffer stamp = MakePortrait(4000, 3000);
+            Bench(res, opt, "rotate90", "4000x3000", photoMp, [&] { auto r = Rotate90(stamp); Keep(r); });
+        }
+
+        Bench(res, opt, "face_detect", "4000x3000", photoMp, [&] { auto f = DetectFace(photo); Keep(f); });
+        Bench(res, opt, "tilt_estimate", "4000x3000", photoMp, [&] { auto t = EstimateTilt(photo); Keep(t); });
+
+        // Colour: LUT build (no cache) and per-stamp apply. sRGB→sRGB
+        // exercises the full matrix/TRC path including curve inversion.
+        auto srgb = IccProfile::Srgb();
+        Bench(res, opt, "icc_lut_build", "grid=33", 0.0, [&] { ColorTransform xf(srgb, srgb); Keep(xf); });
+        {
+            ColorTransform xf(srgb, srgb);
+            PixelBuffer stamp = MakePortrait(600, 600);
+            Bench(res, opt, "icc_apply", "600x600", 0.36, [&] {
+                PixelBuffer c = stamp;
+                xf.Apply(c);
+                Keep(c);
+                });
+        }
+    }
+
+    void SheetSuite(std::vector<Result>& res, const Options& opt)
+    {
+        struct Case { double sw, sh, iw, ih; };
+        const Case cases[] = { { 6, 4, 2, 2 }, { 10, 8, 1.378, 1.772 }, { 19, 13, 2, 2 } };
+        for (const auto& c : cases)
+        {
+            auto layout = CalculateOptimalPlacement(c.sw, c.sh, c.iw, c.ih, 0.05, kPpu);
+            PixelBuffer stamp = MakePortrait(layout.metrics.cellW, layout.metrics.cellH);
+            PixelBuffer rotated = Rotate90(stamp);
+            int W = layout.metrics.sheetW, H = layout.metrics.sheetH;
+            double mp = static_cast<double>(W) * H / 1e6;
+            std::string params = "sheet=" + Dim(c.sw, c.sh) + " stamp=" + Dim(c.iw, c.ih);
+
+            Bench(res, opt, "compose", params, mp, [&] {
+                auto s = ComposeSheet(W, H, layout.placements, stamp, rotated);
+                Keep(s);
+                });
+
+            PixelBuffer sheet = ComposeSheet(W, H, layout.placements, stamp, rotated);
+
+            // Streamed raster: one band in memory, bytes counted and dropped.
+            struct CountingSink : ByteSink
+            {
+                uint64_t bytes = 0;
+                bool Write(const uint8_t*, size_t n) override { bytes += n; return true; }
+            };
+            Bench(res, opt, "stream_pwg", params, mp, [&] {
+                CountingSink sink;
+                StreamSheet(layout, stamp, rotated, RasterFormat::Pwg, RasterColor::Srgb, static_cast<int>(kPpu), sink);
+                Keep(sink.bytes);
+                });
+#ifdef PT_BENCH_HAVE_PNG
+            Bench(res, opt, "encode_png", params, mp, [&] { auto b = EncodePng(sheet); Keep(b); });
+            {
+                auto png = EncodePng(sheet);
+                auto srgb = IccProfile::Srgb();
+                Bench(res, opt, "embed_icc_png", params, 0.0, [&] { auto b = png; EmbedIccInPng(b, srgb); Keep(b); });
+            }
+#endif
+#ifdef PT_BENCH_HAVE_JPEG
+            Bench(res, opt, "encode_jpeg", params + " q=90", mp, [&] { auto b = EncodeJpeg(sheet, 90); Keep(b); });
+#endif
+        }
+    }
+
+    // Roll media: the one-off unit search, and streamed rolls of growing
+    // length (peak_bytes should stay at one band plus the stamps).
+    void RollSuite(std::vector<Result>& res, const Options& opt)
+    {
+        auto metrics = ToDevicePixels(6, 0, 1.378, 1.772, 0.05, kPpu);
+        Bench(res, opt, "roll_unit", "width=6 stamp=1.378x1.772", 0.0, [&] {
+            auto u = CalculateRollUnit(metrics);
+            Keep(u);
+            });
+
+        RollLayout roll(CalculateRollUnit(metrics));
+        PixelBuffer stamp = MakePortrait(metrics.cellW, metrics.cellH);
+        PixelBuffer rotated = Rotate90(stamp);
+        struct CountingSink : ByteSink
+        {
+            uint64_t bytes = 0;
+            bool Write(const uint8_t*, size_t n) override { bytes += n; return true; }
+        };
+        for (uint64_t count : { 10ull, 100ull, 1000ull })
+        {
+            double mp = static_cast<double>(metrics.sheetW) * roll.LengthFor(count) / 1e6;
+            Bench(res, opt, "stream_roll", "width=6 stamps=" + std::to_string(count), mp, [&] {
+                CountingSink sink;
+                StreamRoll(roll, count, stamp, rotated, RasterFormat::Pwg, RasterColor::Srgb, static_cast<int>(kPpu), sink);
+                Keep(sink.bytes);
+                });
+        }
+    }
+
+    // Reopen path: hashing the encoded file, and a cache hit (map + copy
+    // out) versus building the pyramid on a miss.
+    void CacheSuite(std::vector<Result>& res, const Options& opt)
+    {
+        PixelBuffer photo = MakePortrait(4000, 3000);
+        double mp = 12.0;
+        Bench(res, opt, "content_hash", "48MB", mp, [&] {
+            auto h = HashBytes(photo.data.data(), photo.data.size());
+            Keep(h);
+            });
+        Bench(res, opt, "build_pyramid", "4000x3000", mp, [&] { auto p = BuildPyramid(photo, 256); Keep(p); });
+
+        auto dir = std::filesystem::temp_directory_path() / "passport_bench_cache";
+        {
+            PixelCache cache(dir, 1ull << 30);
+            cache.Store(1, photo);
+            Bench(res, opt, "cache_hit", "4000x3000", mp, [&] {
+                auto m = cache.Find(1);
+                auto copy = m->ToPixelBuffer();
+                Keep(copy);
+                });
+        }
+        std::error_code ec;
+        std::filesystem::remove_all(dir, ec);
+    }
+
+    // Cost of the instrumentation itself: one span open/close, enabled and
+    // disabled, and a summary/export over a full ring.
+    void TraceSuite(std::vector<Result>& res, const Options& opt)
+    {
+        SetTraceEnabled(true);
+        Bench(res, opt, "trace_span", "enabled", 0.0, [] { TraceSpan s("bench.span"); });
+        SetTraceEnabled(false);
+        Bench(res, opt, "trace_span", "disabled", 0.0, [] { TraceSpan s("bench.span"); });
+        SetTraceEnabled(true);
+        Bench(res, opt, "trace_export", "chrome_json", 0.0, [] { auto j = ExportChromeTrace(); Keep(j); });
+        ClearTrace();
+    }
+
+    // Fork/join cost on the shared pool, and how long an interactive task
+    // waits while every worker is busy with background chunks.
+    void SchedulerSuite(std::vector<Result>& res, const Options& opt)
+    {
+        auto& pool = TaskScheduler::Shared();
+        Bench(res, opt, "parallel_for", "64 empty chunks", 0.0, [] {
+            ParallelFor(64, 1, [](int b, int e) { Keep(e - b); });
+            });
+
+        std::atomic<bool> busy{ true };
+        std::atomic<int> chains{ 0 };
+        std::function<void()> chunk = [&] {
+            auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(500);
+            while (std::chrono::steady_clock::now() < until) {}
+            if (busy) pool.Submit(TaskPriority::Background, chunk);
+            else --chains;
+        };
+        for (unsigned i = 0; i < pool.WorkerCount() * 2; ++i)
+        {
+            ++chains;
+            pool.Submit(TaskPriority::Background, chunk);
+        }
+        Bench(res, opt, "interactive_wait", "background=saturated", 0.0, [&] {
+            std::atomic<bool> ran{ false };
+            pool.Submit(TaskPriority::Interactive, [&] { ran = true; });
+            while (!ran) std::this_thread::yield();
+            });
+        busy = false;
+        while (chains > 0) std::this_thread::yield();
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Report
+    // ──────────────────────────────────────────────────────────────
+
+    std::string Escape(const std::string& s)
+    {
+        std::string o;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\') o.push_back('\\');
+            o.push_back(c);
+        }
+        return o;
+    }
+
+    std::string ToJson(const std::vector<Result>& results)
+    {
+        long rssKb = -1;
+#if defined(__unix__) || defined(__APPLE__)
+        rusage ru{};
+        if (getrusage(RUSAGE_SELF, &ru) == 0)
+        {
+#ifdef __APPLE__
+            rssKb = ru.ru_maxrss / 1024;
+#else
+            rssKb = ru.ru_maxrss;
+#endif
+        }
+#endif
+        std::ostringstream o;
+        o << "{\n  \"schema\": 1,\n"
+          << "  \"threads\": " << std::thread::hardware_concurrency() << ",\n"
+          << "  \"peak_rss_kb\": " << rssKb << ",\n"
+          << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& r = results[i];
+            char mp[32] = "null";
+            if (r.mpPerSec > 0) std::snprintf(mp, sizeof(mp), "%.2f", r.mpPerSec);
+            char num[160];
+            std::snprintf(num, sizeof(num), "\"iterations\": %ld, \"ns_per_op\": %.1f, \"mp_per_s\": %s, \"peak_bytes\": %zu",
+                r.iterations, r.nsPerOp, mp, r.peakBytes);
+            o << "    {\"name\": \"" << Escape(r.name) << "\", \"params\": \"" << Escape(r.params) << "\", " << num << "}"
+              << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        o << "  ]\n}\n";
+        return o.str();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a.rfind("--filter=", 0) == 0) opt.filter = a.substr(9);
+        else if (a.rfind("--out=", 0) == 0) opt.out = a.substr(6);
+        else if (a.rfind("--min-time=", 0) == 0) opt.minTime = std::atof(a.c_str() + 11);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--filter=substr] [--out=file.json] [--min-time=seconds]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    LayoutSuite(results, opt);
+    PixelSuite(results, opt);
+    SheetSuite(results, opt);
+    RollSuite(results, opt);
+    CacheSuite(results, opt);
+    TraceSuite(results, opt);
+    SchedulerSuite(results, opt);
+
+    std::string json = ToJson(results);
+    if (opt.out.empty())
+    {
+        std::cout << json;
+    }
+    else
+    {
+        std::ofstream f(opt.out);
+        f << json;
+        if (!f) { std::fprintf(stderr, "cannot write %s\n", opt.out.c_str()); return 1; }
+    }
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include "BackgroundReplacer.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr int kClusters = 3;
+        constexpr int kRowsPerTask = 32;
+
+        struct Rgb { int b, g, r; };
+
+        // Squared colour distance; thresholds are squared to match, so no
+        // per-pixel sqrt.
+        int DistanceSq(const uint8_t* p, const Rgb& c)
+        {
+            int db = p[0] - c.b, dg = p[1] - c.g, dr = p[2] - c.r;
+            return db * db + dg * dg + dr * dr;
+        }
+
+        int Step(const uint8_t* a, const uint8_t* b)
+        {
+            return std::max({ std::abs(a[0] - b[0]), std::abs(a[1] - b[1]), std::abs(a[2] - b[2]) });
+        }
+
+        // Pixels allowed to seed/define the backdrop: the top band and the
+        // upper 60 % of the left/right bands.
+        template <typename Fn>
+        void ForEachEdgePixel(const PixelBuffer& img, int band, Fn&& fn)
+        {
+            int sideRows = (img.height * 3) / 5;
+            for (int y = 0; y < img.height; ++y)
+            {
+                bool top = y < band;
+                if (!top && y >= sideRows) break;
+                for (int x = 0; x < img.width; ++x)
+                {
+                    if (top || x < band || x >= img.width - band)
+                        fn(x, y);
+                }
+            }
+        }
+
+        std::array<Rgb, kClusters> FitBackdrop(const PixelBuffer& img, int band)
+        {
+            std::vector<Rgb> samples;
+            ForEachEdgePixel(img, band, [&](int x, int y) {
+                const uint8_t* p = img.Row(y) + x * 4;
+                samples.push_back({ p[0], p[1], p[2] });
+                });
+
+            std::array<Rgb, kClusters> centers{};
+            if (samples.empty()) return centers;
+            for (int k = 0; k < kClusters; ++k)
+                centers[k] = samples[(samples.size() * (2 * k + 1)) / (2 * kClusters)];
+
+            std::array<long long, kClusters * 4> acc{};
+            for (int iter = 0; iter < 6; ++iter)
+            {
+                acc.fill(0);
+                for (const auto& s : samples)
+                {
+                    int best = 0, bestD = 1 << 30;
+                    for (int k = 0; k < kClusters; ++k)
+                    {
+                        int d = (s.b - centers[k].b) * (s.b - centers[k].b) +
+                            (s.g - centers[k].g) * (s.g - centers[k].g) +
+                            (s.r - centers[k].r) * (s.r - centers[k].r);
+                        if (d < bestD) { bestD = d; best = k; }
+                    }
+                    acc[best * 4 + 0] += s.b; acc[best * 4 + 1] += s.g;
+                    acc[best * 4 + 2] += s.r; acc[best * 4 + 3] += 1;
+                }
+                for (int k = 0; k < kClusters; ++k)
+                {
+                    long long n = acc[k * 4 + 3];
+                    if (n == 0) continue;
+                    centers[k] = { static_cast<int>(acc[k * 4] / n),
+                        static_cast<int>(acc[k * 4 + 1] / n),
+                        static_cast<int>(acc[k * 4 + 2] / n) };
+                }
+            }
+            return centers;
+        }
+
+        // Separable box blur of an 8-bit plane, radius r.
+        void BoxBlur(std::vector<uint8_t>& plane, int w, int h, int r, bool parallel)
+        {
+            if (r <= 0) return;
+            std::vector<uint8_t> tmp(plane.size());
+            int minRows = parallel ? kRowsPerTask : h;
+            int win = 2 * r + 1;
+
+            ParallelFor(h, minRows, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y)
+                {
+                    const uint8_t* in = plane.data() + static_cast<size_t>(y) * w;
+                    uint8_t* out = tmp.data() + static_cast<size_t>(y) * w;
+                    for (int x = 0; x < w; ++x)
+                    {
+                        int s = 0;
+                        for (int k = -r; k <= r; ++k) s += in[std::clamp(x + k, 0, w - 1)];
+                        out[x] = static_cast<uint8_t>(s / win);
+                    }
+                }
+                });
+            ParallelFor(h, minRows, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y)
+                {
+                    uint8_t* out = plane.data() + static_cast<size_t>(y) * w;
+                    for (int x = 0; x < w; ++x)
+                    {
+                        int s = 0;
+                        for (int k = -r; k <= r; ++k)
+                            s += tmp[static_cast<size_t>(std::clamp(y + k, 0, h - 1)) * w + x];
+                        out[x] = static_cast<uint8_t>(s / win);
+                    }
+                }
+                });
+        }
+
+        double Replace(PixelBuffer& img, const BackgroundOptions& opt, bool parallel)
+        {
+            if (img.Empty()) return 0.0;
+            const int W = img.width, H = img.height;
+            const size_t N = static_cast<size_t>(W) * H;
+            const int minRows = parallel ? kRowsPerTask : H;
+            int band = std::max(2, std::min(W, H) / 50);
+
+            auto centers = FitBackdrop(img, band);
+
+            // Squared distance of every pixel to its nearest backdrop
+            // cluster, saturated at 16 bits (a distance of 255).
+            const int tolerance = opt.tolerance * opt.tolerance;
+            const int mixed = 4 * tolerance;    // twice the tolerance, squared
+            std::vector<uint16_t> dist(N);
+            ParallelFor(H, minRows, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y)
+                {
+                    const uint8_t* row = img.Row(y);
+                    uint16_t* d = dist.data() + static_cast<size_t>(y) * W;
+                    for (int x = 0; x < W; ++x)
+                    {
+                        int best = 0xFFFF;
+                        for (const auto& c : centers) best = std::min(best, DistanceSq(row + x * 4, c));
+                        d[x] = static_cast<uint16_t>(best);
+                    }
+                }
+                });
+
+            // Flood fill in strips of rows: each strip fills in parallel
+            // without leaving its rows, then backdrop pixels that reach
+            // across a strip edge seed the neighbouring strip for another
+            // round. Reachability does not depend on visiting order, so the
+            // mask matches a single sequential fill.
+            std::vector<uint8_t> bg(N, 0);
+            auto joins = [&](size_t from, size_t to) {
+                return !bg[to] && dist[to] <= tolerance &&
+                    Step(img.data.data() + from * 4, img.data.data() + to * 4) <= opt.edgeStop;
+                };
+            const int workers = static_cast<int>(TaskScheduler::Shared().WorkerCount());
+            const int stripRows = parallel ? std::max(kRowsPerTask, (H + workers - 1) / workers) : H;
+            const int strips = (H + stripRows - 1) / stripRows;
+            std::vector<std::vector<int>> seeds(strips);
+            ForEachEdgePixel(img, 1, [&](int x, int y) {
+                size_t i = static_cast<size_t>(y) * W + x;
+                if (dist[i] <= tolerance && !bg[i])
+                {
+                    bg[i] = 1;
+                    seeds[y / stripRows].push_back(static_cast<int>(i));
+                }
+                });
+
+            for (bool pending = true; pending;)
+            {
+                ParallelFor(strips, 1, [&](int s0, int s1) {
+                    for (int s = s0; s < s1; ++s)
+                    {
+                        const int top = s * stripRows, bottom = std::min(H, top + stripRows);
+                        auto& stack = seeds[s];
+                        while (!stack.empty())
+                        {
+                            int i = stack.back();
+                            stack.pop_back();
+                            int x = i % W, y = i / W;
+                            auto visit = [&](int nx, int ny) {
+                                if (nx < 0 || ny < top || nx >= W || ny >= bottom) return;
+                                size_t n = static_cast<size_t>(ny) * W + nx;
+                                if (!joins(static_cast<size_t>(i), n)) return;
+                                bg[n] = 1;
+                                stack.push_back(static_cast<int>(n));
+                                };
+                            visit(x - 1, y); visit(x + 1, y); visit(x, y - 1); visit(x, y + 1);
+                        }
+                    }
+                    });
+
+                pending = false;
+                for (int s = 1; s < strips; ++s)
+                {
+                    size_t above = static_cast<size_t>(s * stripRows - 1) * W;
+                    size_t below = above + W;
+                    for (int x = 0; x < W; ++x)
+                    {
+                        size_t a = above + x, b = below + x;
+                        if (bg[a] && joins(a, b)) { bg[b] = 1; seeds[s].push_back(static_cast<int>(b)); pending = true; }
+                        else if (bg[b] && joins(b, a)) { bg[a] = 1; seeds[s - 1].push_back(static_cast<int>(a)); pending = true; }
+                    }
+                }
+            }
+
+            std::vector<uint8_t> mask(N, 255);  // 0 = backdrop, 255 = subject
+
+            size_t bgCount = 0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                mask[i] = bg[i] ? 0 : 255;
+                bgCount += bg[i];
+            }
+
+            std::vector<uint8_t> soft = mask;
+            BoxBlur(soft, W, H, opt.feather, parallel);
+
+            const int fill[3] = { opt.fillB, opt.fillG, opt.fillR };
+            ParallelFor(H, minRows, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y)
+                {
+                    uint8_t* row = img.Row(y);
+                    size_t base = static_cast<size_t>(y) * W;
+                    for (int x = 0; x < W; ++x)
+                    {
+                        size_t i = base + x;
+                        int a = mask[i];
+                        if (a && dist[i] < mixed) a = soft[i];
+                        if (a == 255) continue;
+                        uint8_t* p = row + x * 4;
+                        for (int c = 0; c < 3; ++c)
+                            p[c] = static_cast<uint8_t>((p[c] * a + fill[c] * (255 - a) + 127) / 255);
+                        p[3] = 255;
+                    }
+                }
+                });
+
+            return static_cast<double>(bgCount) / N;
+        }
+    }
+
+    double ReplaceBackground(PixelBuffer& image, const BackgroundOptions& options)
+    {
+        return Replace(image, options, true);
+    }
+
+    void ReplaceBackgroundBatch(std::vector<PixelBuffer>& images, const BackgroundOptions& options)
+    {
+        ParallelFor(static_cast<int>(images.size()), 1, [&](int b, int e) {
+            for (int i = b; i < e; ++i) Replace(images[i], options, false);
+            });
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Replaces the backdrop behind the subject with a flat colour.
+//
+// 1. Colour model: k-means over the top edge and upper side edges of the
+//    frame (the bottom edge is usually shoulders, so it is never sampled).
+// 2. Segmentation: flood fill from those edges through pixels that match
+//    the model, stopping at strong local colour steps. Strips of rows fill
+//    in parallel and hand over across their edges.
+// 3. Refinement: the hard mask is feathered only where the pixel colour is
+//    still close to the backdrop, so hair and ear edges blend instead of
+//    keeping a halo, while crisp clothing edges stay hard.
+
+#include "PixelBuffer.h"
+#include <vector>
+
+namespace PassportTool::Core
+{
+    struct BackgroundOptions
+    {
+        uint8_t fillB{ 255 }, fillG{ 255 }, fillR{ 255 };
+        int tolerance{ 40 };     // max colour distance to a backdrop cluster
+        int edgeStop{ 28 };      // max neighbour-to-neighbour step inside the backdrop
+        int feather{ 2 };        // refinement radius in pixels
+    };
+
+    // In-place; returns the fraction of pixels classified as backdrop.
+    double ReplaceBackground(PixelBuffer& image, const BackgroundOptions& options = {});
+
+    // Batch mode: one image per worker, each processed single-threaded.
+    void ReplaceBackgroundBatch(std::vector<PixelBuffer>& images, const BackgroundOptions& options = {});
+}
@@ -0,0 +1,651 @@
+#include "ColorManagement.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PT_HAVE_SSE2 1
+#endif
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr double kD50[3] = { 0.9642, 1.0, 0.8249 };
+
+        uint32_t Sig(const char (&s)[5])
+        {
+            return (uint32_t(uint8_t(s[0])) << 24) | (uint32_t(uint8_t(s[1])) << 16) |
+                (uint32_t(uint8_t(s[2])) << 8) | uint32_t(uint8_t(s[3]));
+        }
+
+        struct Reader
+        {
+            const std::vector<uint8_t>& b;
+
+            bool Has(size_t off, size_t n) const { return off <= b.size() && n <= b.size() - off; }
+            uint8_t U8(size_t o) const { return b[o]; }
+            uint16_t U16(size_t o) const { return uint16_t((b[o] << 8) | b[o + 1]); }
+            uint32_t U32(size_t o) const
+            {
+                return (uint32_t(b[o]) << 24) | (uint32_t(b[o + 1]) << 16) | (uint32_t(b[o + 2]) << 8) | b[o + 3];
+            }
+            double S15F16(size_t o) const { return static_cast<int32_t>(U32(o)) / 65536.0; }
+        };
+
+        uint64_t Fnv1a(const uint8_t* p, size_t n, uint64_t h = 1469598103934665603ull)
+        {
+            for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+            return h;
+        }
+
+        std::array<double, 9> Invert3x3(const std::array<double, 9>& m)
+        {
+            double a = m[0], b = m[1], c = m[2], d = m[3], e = m[4], f = m[5], g = m[6], h = m[7], i = m[8];
+            double A = e * i - f * h, B = -(d * i - f * g), C = d * h - e * g;
+            double det = a * A + b * B + c * C;
+            if (std::abs(det) < 1e-12) return { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+            double k = 1.0 / det;
+            return { A * k, -(b * i - c * h) * k, (b * f - c * e) * k,
+                     B * k, (a * i - c * g) * k, -(a * f - c * d) * k,
+                     C * k, -(a * h - b * g) * k, (a * e - b * d) * k };
+        }
+
+        std::array<double, 3> Mul(const std::array<double, 9>& m, const std::array<double, 3>& v)
+        {
+            return { m[0] * v[0] + m[1] * v[1] + m[2] * v[2],
+                     m[3] * v[0] + m[4] * v[1] + m[5] * v[2],
+                     m[6] * v[0] + m[7] * v[1] + m[8] * v[2] };
+        }
+
+        double Clamp01(double v) { return v < 0 ? 0 : (v > 1 ? 1 : v); }
+
+        double Interp1(const std::vector<double>& t, size_t base, size_t n, double x)
+        {
+            if (n == 0) return x;
+            if (n == 1) return t[base];
+            double pos = Clamp01(x) * (n - 1);
+            size_t i = std::min(static_cast<size_t>(pos), n - 2);
+            double f = pos - i;
+            return t[base + i] + (t[base + i + 1] - t[base + i]) * f;
+        }
+
+        // Lab ↔ XYZ, D50.
+        double LabF(double t) { return t > 216.0 / 24389.0 ? std::cbrt(t) : (24389.0 / 27.0 * t + 16.0) / 116.0; }
+        double LabFInv(double t) { return t * t * t > 216.0 / 24389.0 ? t * t * t : (116.0 * t - 16.0) * 27.0 / 24389.0; }
+
+        std::array<double, 3> XyzToLab(const std::array<double, 3>& x)
+        {
+            double fx = LabF(x[0] / kD50[0]), fy = LabF(x[1] / kD50[1]), fz = LabF(x[2] / kD50[2]);
+            return { 116.0 * fy - 16.0, 500.0 * (fx - fy), 200.0 * (fy - fz) };
+        }
+
+        std::array<double, 3> LabToXyz(const std::array<double, 3>& l)
+        {
+            double fy = (l[0] + 16.0) / 116.0, fx = fy + l[1] / 500.0, fz = fy - l[2] / 200.0;
+            return { LabFInv(fx) * kD50[0], LabFInv(fy) * kD50[1], LabFInv(fz) * kD50[2] };
+        }
+
+        // PCS values as seen by lut8/lut16 tables (legacy encodings). lut8
+        // Lab maps L 0..100 and a/b -128..127 onto 0..255; lut16 uses the
+        // 16-bit v2 scaling. XYZ has only the 16-bit form.
+        std::array<double, 3> EncodePcs(const std::array<double, 3>& xyz, bool lab, bool eightBit)
+        {
+            if (lab)
+            {
+                auto l = XyzToLab(xyz);
+                if (eightBit)
+                    return { Clamp01(l[0] / 100.0), Clamp01((l[1] + 128.0) / 255.0), Clamp01((l[2] + 128.0) / 255.0) };
+                return { Clamp01(l[0] / 100.0 * (65280.0 / 65535.0)),
+                         Clamp01((l[1] + 128.0) * 256.0 / 65535.0),
+                         Clamp01((l[2] + 128.0) * 256.0 / 65535.0) };
+            }
+            constexpr double k = 32768.0 / 65535.0;
+            return { Clamp01(xyz[0] * k), Clamp01(xyz[1] * k), Clamp01(xyz[2] * k) };
+        }
+
+        std::array<double, 3> DecodePcs(const std::array<double, 3>& v, bool lab, bool eightBit)
+        {
+            if (lab && eightBit)
+                return LabToXyz({ v[0] * 100.0, v[1] * 255.0 - 128.0, v[2] * 255.0 - 128.0 });
+            if (lab)
+                return LabToXyz({ v[0] * 100.0 * (65535.0 / 65280.0),
+                                  v[1] * 65535.0 / 256.0 - 128.0,
+                                  v[2] * 65535.0 / 256.0 - 128.0 });
+            constexpr double k = 65535.0 / 32768.0;
+            return { v[0] * k, v[1] * k, v[2] * k };
+        }
+
+        bool ParseCurve(const Reader& r, size_t off, size_t size, IccProfile::Curve& c)
+        {
+            if (size < 12 || !r.Has(off, size)) return false;
+            uint32_t type = r.U32(off);
+            if (type == Sig("curv"))
+            {
+                uint32_t n = r.U32(off + 8);
+                if (n == 0) { c.p[0] = 1.0; return true; }
+                if (n == 1)
+                {
+                    if (!r.Has(off + 12, 2)) return false;
+                    c.p[0] = r.U16(off + 12) / 256.0;
+                    return true;
+                }
+                if (!r.Has(off + 12, size_t(n) * 2)) return false;
+                c.table.resize(n);
+                for (uint32_t i = 0; i < n; ++i) c.table[i] = r.U16(off + 12 + i * 2) / 65535.0;
+                return true;
+            }
+            if (type == Sig("para"))
+            {
+                static const int kCounts[5] = { 1, 3, 4, 5, 7 };
+                int fn = r.U16(off + 8);
+                if (fn < 0 || fn > 4 || !r.Has(off + 12, size_t(kCounts[fn]) * 4)) return false;
+                c.paraType = fn;
+                for (int i = 0; i < kCounts[fn]; ++i) c.p[i] = r.S15F16(off + 12 + i * 4);
+                return true;
+            }
+            return false;
+        }
+
+        std::shared_ptr<const IccProfile::Lut> ParseLut(const Reader& r, size_t off, size_t size)
+        {
+            if (size < 52 || !r.Has(off, size)) return nullptr;
+            uint32_t type = r.U32(off);
+            bool is16 = type == Sig("mft2");
+            if (!is16 && type != Sig("mft1")) return nullptr;
+            if (r.U8(off + 8) != 3 || r.U8(off + 9) != 3) return nullptr;
+
+            auto lut = std::make_shared<IccProfile::Lut>();
+            lut->eightBit = !is16;
+            lut->grid = r.U8(off + 10);
+            if (lut->grid < 2) return nullptr;
+            for (int i = 0; i < 9; ++i) lut->matrix[i] = r.S15F16(off + 12 + i * 4);
+
+            size_t p = off + 48;
+            if (is16)
+            {
+                lut->inEntries = r.U16(off + 48);
+                lut->outEntries = r.U16(off + 50);
+                p = off + 52;
+            }
+            else
+            {
+                lut->inEntries = lut->outEntries = 256;
+            }
+
+            size_t g3 = size_t(lut->grid) * lut->grid * lut->grid;
+            size_t unit = is16 ? 2 : 1;
+            size_t need = (size_t(3) * lut->inEntries + g3 * 3 + size_t(3) * lut->outEntries) * unit;
+            if (!r.Has(p, need)) return nullptr;
+
+            auto read = [&](std::vector<double>& dst, size_t n) {
+                dst.resize(n);
+                for (size_t i = 0; i < n; ++i, p += unit)
+                    dst[i] = is16 ? r.U16(p) / 65535.0 : r.U8(p) / 255.0;
+                };
+            read(lut->in, size_t(3) * lut->inEntries);
+            read(lut->clut, g3 * 3);
+            read(lut->out, size_t(3) * lut->outEntries);
+            return lut;
+        }
+
+        std::string ParseDescription(const Reader& r, size_t off, size_t size)
+        {
+            if (size < 12 || !r.Has(off, size)) return {};
+            uint32_t type = r.U32(off);
+            std::string s;
+            if (type == Sig("desc"))
+            {
+                uint32_t n = r.U32(off + 8);
+                if (!r.Has(off + 12, n)) return {};
+                for (uint32_t i = 0; i < n && r.U8(off + 12 + i); ++i) s.push_back(static_cast<char>(r.U8(off + 12 + i)));
+            }
+            else if (type == Sig("mluc") && size >= 28)
+            {
+                uint32_t len = r.U32(off + 20), at = r.U32(off + 24);
+                if (!r.Has(off + at, len)) return {};
+                for (uint32_t i = 0; i + 1 < len; i += 2)
+                {
+                    uint16_t ch = r.U16(off + at + i);
+                    s.push_back(ch < 128 ? static_cast<char>(ch) : '?');
+                }
+            }
+            return s;
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Curves & LUTs
+    // ──────────────────────────────────────────────────────────────
+
+    double IccProfile::Curve::Eval(double x) const
+    {
+        x = Clamp01(x);
+        if (!table.empty()) return Interp1(table, 0, table.size(), x);
+
+        const double g = p[0], a = p[1], b = p[2], c = p[3], d = p[4], e = p[5], f = p[6];
+        switch (paraType)
+        {
+        case 1: return (x >= -b / a) ? std::pow(a * x + b, g) : 0.0;
+        case 2: return (x >= -b / a) ? std::pow(a * x + b, g) + c : c;
+        case 3: return (x >= d) ? std::pow(a * x + b, g) : c * x;
+        case 4: return (x >= d) ? std::pow(a * x + b, g) + e : c * x + f;
+        default: return std::pow(x, g);
+        }
+    }
+
+    double IccProfile::Curve::Inverse(double y) const
+    {
+        // Curves are monotonic in practice; bisection keeps every type on one path.
+        double lo = 0.0, hi = 1.0;
+        bool rising = Eval(1.0) >= Eval(0.0);
+        for (int i = 0; i < 24; ++i)
+        {
+            double mid = 0.5 * (lo + hi);
+            if ((Eval(mid) < y) == rising) lo = mid; else hi = mid;
+        }
+        return 0.5 * (lo + hi);
+    }
+
+    std::array<double, 3> IccProfile::Lut::Eval(std::array<double, 3> v, bool applyMatrix) const
+    {
+        if (applyMatrix) v = Mul(matrix, v);
+        for (int c = 0; c < 3; ++c)
+            v[c] = Interp1(in, size_t(c) * inEntries, inEntries, Clamp01(v[c]));
+
+        // Trilinear over the CLUT; first channel varies slowest.
+        int ix[3];
+        double fx[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            double pos = Clamp01(v[c]) * (grid - 1);
+            ix[c] = std::min(static_cast<int>(pos), grid - 2);
+            fx[c] = pos - ix[c];
+        }
+        std::array<double, 3> o{ 0, 0, 0 };
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            double w = 1.0;
+            size_t idx = 0;
+            for (int c = 0; c < 3; ++c)
+            {
+                int bit = (corner >> (2 - c)) & 1;
+                w *= bit ? fx[c] : 1.0 - fx[c];
+                idx = idx * grid + ix[c] + bit;
+            }
+            if (w == 0.0) continue;
+            for (int c = 0; c < 3; ++c) o[c] += w * clut[idx * 3 + c];
+        }
+
+        for (int c = 0; c < 3; ++c)
+            o[c] = Interp1(out, size_t(c) * outEntries, outEntries, Clamp01(o[c]));
+        return o;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Profile parsing
+    // ──────────────────────────────────────────────────────────────
+
+    std::optional<IccProfile> IccProfile::Parse(std::vector<uint8_t> bytes, std::string* error)
+    {
+        auto fail = [&](const char* why) -> std::optional<IccProfile> {
+            if (error) *error = why;
+            return std::nullopt;
+            };
+
+        Reader r{ bytes };
+        if (bytes.size() < 132 || r.U32(36) != Sig("acsp")) return fail("not an ICC profile");
+        if (r.U32(16) != Sig("RGB ")) return fail("only RGB profiles are supported");
+
+        IccProfile prof;
+        uint32_t pcs = r.U32(20);
+        if (pcs != Sig("XYZ ") && pcs != Sig("Lab ")) return fail("unknown PCS");
+        prof.m_pcsLab = pcs == Sig("Lab ");
+
+        uint32_t count = r.U32(128);
+        if (!r.Has(132, size_t(count) * 12)) return fail("truncated tag table");
+
+        struct Tag { size_t off, size; };
+        std::map<uint32_t, Tag> tags;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            size_t e = 132 + size_t(i) * 12;
+            tags[r.U32(e)] = { r.U32(e + 4), r.U32(e + 8) };
+        }
+        auto find = [&](const char (&s)[5]) -> const Tag* {
+            auto it = tags.find(Sig(s));
+            return it == tags.end() ? nullptr : &it->second;
+            };
+
+        if (auto t = find("desc")) prof.m_description = ParseDescription(r, t->off, t->size);
+        if (auto t = find("A2B0")) prof.m_a2b = ParseLut(r, t->off, t->size);
+        if (auto t = find("B2A0")) prof.m_b2a = ParseLut(r, t->off, t->size);
+
+        const Tag* xyz[3] = { find("rXYZ"), find("gXYZ"), find("bXYZ") };
+        const Tag* trc[3] = { find("rTRC"), find("gTRC"), find("bTRC") };
+        if (xyz[0] && xyz[1] && xyz[2] && trc[0] && trc[1] && trc[2])
+        {
+            bool ok = true;
+            for (int c = 0; c < 3 && ok; ++c)
+            {
+                ok = r.Has(xyz[c]->off, 20) && r.U32(xyz[c]->off) == Sig("XYZ ") &&
+                    ParseCurve(r, trc[c]->off, trc[c]->size, prof.m_trc[c]);
+                if (!ok) break;
+                // Columns of the matrix are the colorant XYZs.
+                for (int k = 0; k < 3; ++k) prof.m_matrix[k * 3 + c] = r.S15F16(xyz[c]->off + 8 + k * 4);
+            }
+            if (ok)
+            {
+                prof.m_hasMatrix = true;
+                prof.m_inverse = Invert3x3(prof.m_matrix);
+            }
+        }
+
+        if (!prof.m_hasMatrix && (!prof.m_a2b || !prof.m_b2a))
+            return fail("profile needs matrix/TRC or lut8/lut16 A2B0+B2A0 tags");
+
+        prof.m_hash = Fnv1a(bytes.data(), bytes.size());
+        prof.m_bytes = std::move(bytes);
+        return prof;
+    }
+
+    IccProfile IccProfile::Srgb()
+    {
+        IccProfile p;
+        p.m_description = "sRGB IEC61966-2.1";
+        p.m_hash = Fnv1a(reinterpret_cast<const uint8_t*>(p.m_description.data()), p.m_description.size());
+        p.m_hasMatrix = true;
+        p.m_matrix = { 0.4360747, 0.3850649, 0.1430804,
+                       0.2225045, 0.7168786, 0.0606169,
+                       0.0139322, 0.0971045, 0.7141733 };
+        p.m_inverse = Invert3x3(p.m_matrix);
+        for (auto& c : p.m_trc)
+        {
+            c.paraType = 3;
+            c.p = { 2.4, 1.0 / 1.055, 0.055 / 1.055, 1.0 / 12.92, 0.04045, 0, 0 };
+        }
+        return p;
+    }
+
+    std::array<double, 3> IccProfile::ToPcs(const std::array<double, 3>& rgb) const
+    {
+        if (m_a2b) return DecodePcs(m_a2b->Eval(rgb, false), m_pcsLab, m_a2b->eightBit);
+        std::array<double, 3> lin{ m_trc[0].Eval(rgb[0]), m_trc[1].Eval(rgb[1]), m_trc[2].Eval(rgb[2]) };
+        return Mul(m_matrix, lin);
+    }
+
+    std::array<double, 3> IccProfile::FromPcs(const std::array<double, 3>& xyz) const
+    {
+        if (m_b2a) return m_b2a->Eval(EncodePcs(xyz, m_pcsLab, m_b2a->eightBit), !m_pcsLab);
+        auto lin = Mul(m_inverse, xyz);
+        return { m_trc[0].Inverse(Clamp01(lin[0])), m_trc[1].Inverse(Clamp01(lin[1])), m_trc[2].Inverse(Clamp01(lin[2])) };
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // 3D LUT transform
+    // ──────────────────────────────────────────────────────────────
+
+    ColorTransform::ColorTransform(const IccProfile& source, const IccProfile& destination)
+        : m_nodes(size_t(kGrid) * kGrid * kGrid * 4, 0.0f)
+    {
+        ParallelFor(kGrid, 1, [&](int r0, int r1) {
+            for (int r = r0; r < r1; ++r)
+                for (int g = 0; g < kGrid; ++g)
+                    for (int b = 0; b < kGrid; ++b)
+                    {
+                        std::array<double, 3> rgb{ double(r) / (kGrid - 1), double(g) / (kGrid - 1), double(b) / (kGrid - 1) };
+                        auto out = destination.FromPcs(source.ToPcs(rgb));
+                        float* n = &m_nodes[((size_t(r) * kGrid + g) * kGrid + b) * 4];
+                        for (int c = 0; c < 3; ++c) n[c] = static_cast<float>(Clamp01(out[c]) * 255.0);
+                    }
+            });
+    }
+
+    void ColorTransform::Apply(PixelBuffer& image) const
+    {
+        if (image.Empty()) return;
+
+        struct Axis { int index; float frac; };
+        static const auto axis = [] {
+            std::array<Axis, 256> t{};
+            for (int v = 0; v < 256; ++v)
+            {
+                float pos = v * float(kGrid - 1) / 255.0f;
+                int i = std::min(static_cast<int>(pos), kGrid - 2);
+                t[v] = { i, pos - i };
+            }
+            return t;
+        }();
+
+        constexpr size_t sB = 4, sG = size_t(kGrid) * 4, sR = size_t(kGrid) * kGrid * 4;
+        const float* nodes = m_nodes.data();
+
+        ParallelFor(image.height, 64, [&](int y0, int y1) {
+            uint32_t lastIn = 0xFFFFFFFFu, lastOut = 0;
+            for (int y = y0; y < y1; ++y)
+            {
+                uint8_t* row = image.Row(y);
+                for (int x = 0; x < image.width; ++x)
+                {
+                    uint8_t* px = row + x * 4;
+                    uint32_t key;
+                    std::memcpy(&key, px, 4);
+                    if (key == lastIn) { std::memcpy(px, &lastOut, 4); continue; }
+
+                    int a = px[3];
+                    if (a == 0) continue;
+                    int b = px[0], g = px[1], r = px[2];
+                    if (a < 255)
+                    {
+                        b = std::min(255, b * 255 / a); g = std::min(255, g * 255 / a); r = std::min(255, r * 255 / a);
+                    }
+
+                    const Axis ar = axis[r], ag = axis[g], ab = axis[b];
+                    const float fr = ar.frac, fg = ag.frac, fb = ab.frac;
+                    const size_t base = ar.index * sR + ag.index * sG + ab.index * sB;
+
+                    // Tetrahedral: pick the two inner vertices of the enclosing tetrahedron.
+                    size_t v1, v2;
+                    float w1, w2, w3;
+                    if (fr >= fg)
+                    {
+                        if (fg >= fb)      { v1 = sR; v2 = sR + sG; w1 = fr; w2 = fg; w3 = fb; }
+                        else if (fr >= fb) { v1 = sR; v2 = sR + sB; w1 = fr; w2 = fb; w3 = fg; }
+                        else               { v1 = sB; v2 = sR + sB; w1 = fb; w2 = fr; w3 = fg; }
+                    }
+                    else
+                    {
+                        if (fr >= fb)      { v1 = sG; v2 = sR + sG; w1 = fg; w2 = fr; w3 = fb; }
+                        else if (fg >= fb) { v1 = sG; v2 = sG + sB; w1 = fg; w2 = fb; w3 = fr; }
+                        else               { v1 = sB; v2 = sG + sB; w1 = fb; w2 = fg; w3 = fr; }
+                    }
+                    const float* c0 = nodes + base;
+                    const float* c1 = c0 + v1;
+                    const float* c2 = c0 + v2;
+                    const float* c3 = c0 + sR + sG + sB;
+
+                    float o[4];
+#ifdef PT_HAVE_SSE2
+                    // One node = {r,g,b,pad}: interpolate all three channels per instruction.
+                    __m128 n0 = _mm_loadu_ps(c0), n1 = _mm_loadu_ps(c1), n2 = _mm_loadu_ps(c2), n3 = _mm_loadu_ps(c3);
+                    __m128 acc = _mm_add_ps(n0, _mm_mul_ps(_mm_set1_ps(w1), _mm_sub_ps(n1, n0)));
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w2), _mm_sub_ps(n2, n1)));
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w3), _mm_sub_ps(n3, n2)));
+                    acc = _mm_add_ps(acc, _mm_set1_ps(0.5f));
+                    _mm_storeu_ps(o, acc);
+#else
+                    for (int c = 0; c < 3; ++c)
+                        o[c] = c0[c] + w1 * (c1[c] - c0[c]) + w2 * (c2[c] - c1[c]) + w3 * (c3[c] - c2[c]) + 0.5f;
+#endif
+                    int nr = std::clamp(static_cast<int>(o[0]), 0, 255);
+                    int ng = std::clamp(static_cast<int>(o[1]), 0, 255);
+                    int nb = std::clamp(static_cast<int>(o[2]), 0, 255);
+                    if (a < 255)
+                    {
+                        nr = (nr * a + 127) / 255; ng = (ng * a + 127) / 255; nb = (nb * a + 127) / 255;
+                    }
+                    px[0] = static_cast<uint8_t>(nb);
+                    px[1] = static_cast<uint8_t>(ng);
+                    px[2] = static_cast<uint8_t>(nr);
+
+                    lastIn = key;
+                    std::memcpy(&lastOut, px, 4);
+                }
+            }
+            });
+    }
+
+    std::shared_ptr<const ColorTransform> ColorTransform::Get(const IccProfile& source, const IccProfile& destination)
+    {
+        static std::mutex mutex;
+        static std::map<std::pair<uint64_t, uint64_t>, std::shared_ptr<const ColorTransform>> cache;
+        constexpr size_t kMaxPairs = 8;
+
+        auto key = std::make_pair(source.Hash(), destination.Hash());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = cache.find(key);
+            if (it != cache.end()) return it->second;
+        }
+
+        // Build outside the lock; a racing duplicate build is harmless.
+        auto xf = std::make_shared<const ColorTransform>(source, destination);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.size() >= kMaxPairs) cache.clear();
+        return cache.emplace(key, xf).first->second;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Profile embedding
+    // ──────────────────────────────────────────────────────────────
+
+    namespace
+    {
+        uint32_t Crc32(const uint8_t* p, size_t n, uint32_t crc = 0)
+        {
+            static const auto table = [] {
+                std::array<uint32_t, 256> t{};
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    t[i] = c;
+                }
+                return t;
+            }();
+            crc = ~crc;
+            for (size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        void PutU32(std::vector<uint8_t>& v, uint32_t x)
+        {
+            v.push_back(uint8_t(x >> 24)); v.push_back(uint8_t(x >> 16));
+            v.push_back(uint8_t(x >> 8)); v.push_back(uint8_t(x));
+        }
+
+        // zlib stream using stored (uncompressed) deflate blocks; iCCP
+        // requires zlib framing but not actual compression.
+        std::vector<uint8_t> ZlibStore(const std::vector<uint8_t>& data)
+        {
+            std::vector<uint8_t> z{ 0x78, 0x01 };
+            size_t pos = 0;
+            do
+            {
+                size_t n = std::min<size_t>(65535, data.size() - pos);
+                bool last = pos + n == data.size();
+                z.push_back(last ? 1 : 0);
+                z.push_back(uint8_t(n)); z.push_back(uint8_t(n >> 8));
+                z.push_back(uint8_t(~n)); z.push_back(uint8_t((~n) >> 8));
+                z.insert(z.end(), data.begin() + pos, data.begin() + pos + n);
+                pos += n;
+            } while (pos < data.size());
+
+            uint32_t a = 1, b = 0;
+            for (uint8_t c : data) { a = (a + c) % 65521; b = (b + a) % 65521; }
+            PutU32(z, (b << 16) | a);
+            return z;
+        }
+    }
+
+    bool EmbedIccInPng(std::vector<uint8_t>& png, const IccProfile& profile)
+    {
+        static const uint8_t kSig[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        if (png.size() < 33 || std::memcmp(png.data(), kSig, 8) != 0) return false;
+        if (profile.Bytes().empty()) return true;
+
+        // Drop chunks that conflict with iCCP, and any existing iCCP.
+        std::vector<uint8_t> out(png.begin(), png.begin() + 8);
+        size_t pos = 8;
+        bool inserted = false;
+        while (pos + 12 <= png.size())
+        {
+            uint32_t len = (uint32_t(png[pos]) << 24) | (uint32_t(png[pos + 1]) << 16) | (uint32_t(png[pos + 2]) << 8) | png[pos + 3];
+            if (pos + 12 + size_t(len) > png.size()) return false;
+            std::string type(reinterpret_cast<const char*>(&png[pos + 4]), 4);
+            size_t next = pos + 12 + len;
+
+            if (type != "iCCP" && type != "sRGB")
+                out.insert(out.end(), png.begin() + pos, png.begin() + next);
+
+            if (type == "IHDR" && !inserted)
+            {
+                std::vector<uint8_t> body{ 'i', 'C', 'C', 'P' };
+                std::string name = "ICC profile";
+                body.insert(body.end(), name.begin(), name.end());
+                body.push_back(0);  // name terminator
+                body.push_back(0);  // compression method: zlib
+                auto z = ZlibStore(profile.Bytes());
+                body.insert(body.end(), z.begin(), z.end());
+
+                PutU32(out, static_cast<uint32_t>(body.size() - 4));
+                out.insert(out.end(), body.begin(), body.end());
+                PutU32(out, Crc32(body.data(), body.size()));
+                inserted = true;
+            }
+            pos = next;
+        }
+        if (!inserted) return false;
+        png.swap(out);
+        return true;
+    }
+
+    bool EmbedIccInJpeg(std::vector<uint8_t>& jpeg, const IccProfile& profile)
+    {
+        if (jpeg.size() < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return false;
+        const auto& icc = profile.Bytes();
+        if (icc.empty()) return true;
+
+        // Insert after SOI and any APP0 (JFIF must stay first).
+        size_t at = 2;
+        if (jpeg.size() >= at + 4 && jpeg[at] == 0xFF && jpeg[at + 1] == 0xE0)
+            at += 2 + ((size_t(jpeg[at + 2]) << 8) | jpeg[at + 3]);
+        if (at > jpeg.size()) return false;
+
+        constexpr size_t kMaxChunk = 65519;   // 65535 - length - "ICC_PROFILE\0" - seq - count
+        size_t chunks = (icc.size() + kMaxChunk - 1) / kMaxChunk;
+        if (chunks > 255) return false;
+
+        std::vector<uint8_t> seg;
+        for (size_t i = 0; i < chunks; ++i)
+        {
+            size_t off = i * kMaxChunk;
+            size_t n = std::min(kMaxChunk, icc.size() - off);
+            size_t len = 2 + 12 + 2 + n;
+            seg.push_back(0xFF); seg.push_back(0xE2);
+            seg.push_back(uint8_t(len >> 8)); seg.push_back(uint8_t(len));
+            const char tag[12] = { 'I', 'C', 'C', '_', 'P', 'R', 'O', 'F', 'I', 'L', 'E', 0 };
+            seg.insert(seg.end(), tag, tag + 12);
+            seg.push_back(uint8_t(i + 1));
+            seg.push_back(uint8_t(chunks));
+            seg.insert(seg.end(), icc.begin() + off, icc.begin() + off + n);
+        }
+        jpeg.insert(jpeg.begin() + at, seg.begin(), seg.end());
+        return true;
+    }
+}
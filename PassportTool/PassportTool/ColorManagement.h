@@ -0,0 +1,100 @@
+#pragma once
+
+// ICC colour management for the print path.
+//
+// A source/printer profile pair is evaluated once into a 33³ RGB→RGB
+// lookup table (cached per pair), then applied to the stamp with
+// tetrahedral interpolation — one pass per stamp rather than per
+// placement on the sheet.
+//
+// Supported profiles: RGB matrix/TRC (curv, para) and RGB lut8/lut16
+// (mft1/mft2) A2B0/B2A0 tags with an XYZ or Lab PCS. Anything else
+// (CMYK output, mAB/mBA tags) is rejected at parse time.
+
+#include "PixelBuffer.h"
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    class IccProfile
+    {
+    public:
+        static std::optional<IccProfile> Parse(std::vector<uint8_t> bytes, std::string* error = nullptr);
+
+        // Built-in sRGB (IEC 61966-2-1, D50-adapted), used when no source
+        // profile is given — RenderTargetBitmap output is sRGB.
+        static IccProfile Srgb();
+
+        // RGB in [0,1] → PCS XYZ (D50) and back.
+        std::array<double, 3> ToPcs(const std::array<double, 3>& rgb) const;
+        std::array<double, 3> FromPcs(const std::array<double, 3>& xyz) const;
+
+        const std::vector<uint8_t>& Bytes() const { return m_bytes; }
+        const std::string& Description() const { return m_description; }
+        uint64_t Hash() const { return m_hash; }
+
+        struct Curve
+        {
+            std::vector<double> table;          // sampled curve; empty = use gamma/para
+            int paraType{ -1 };                 // -1 = plain gamma
+            std::array<double, 7> p{ 1, 0, 0, 0, 0, 0, 0 };
+
+            double Eval(double x) const;
+            double Inverse(double y) const;
+        };
+
+        struct Lut
+        {
+            int inEntries{ 0 }, outEntries{ 0 }, grid{ 0 };
+            bool eightBit{ false };             // mft1: 8-bit PCS encoding
+            std::array<double, 9> matrix{ 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+            std::vector<double> in;             // 3 x inEntries, normalized
+            std::vector<double> clut;           // grid³ x 3, normalized
+            std::vector<double> out;            // 3 x outEntries, normalized
+
+            std::array<double, 3> Eval(std::array<double, 3> v, bool applyMatrix) const;
+        };
+
+    private:
+        std::vector<uint8_t> m_bytes;
+        std::string m_description;
+        uint64_t m_hash{ 0 };
+        bool m_pcsLab{ false };
+
+        bool m_hasMatrix{ false };
+        std::array<double, 9> m_matrix{};       // linear RGB → XYZ
+        std::array<double, 9> m_inverse{};      // XYZ → linear RGB
+        std::array<Curve, 3> m_trc;
+
+        std::shared_ptr<const Lut> m_a2b;
+        std::shared_ptr<const Lut> m_b2a;
+    };
+
+    // Precomputed RGB→RGB transform for one profile pair.
+    class ColorTransform
+    {
+    public:
+        static constexpr int kGrid = 33;
+
+        ColorTransform(const IccProfile& source, const IccProfile& destination);
+
+        // In place on premultiplied BGRA; alpha is preserved.
+        void Apply(PixelBuffer& image) const;
+
+        // Shared, per-pair cache so repeated stamps never rebuild the table.
+        static std::shared_ptr<const ColorTransform> Get(const IccProfile& source, const IccProfile& destination);
+
+    private:
+        // kGrid³ nodes of {r, g, b, pad} in [0, 255] so a node is one 16-byte load.
+        std::vector<float> m_nodes;
+    };
+
+    // Embed an ICC profile into an already-encoded file. Return false when
+    // the stream is not a well-formed PNG/JPEG.
+    bool EmbedIccInPng(std::vector<uint8_t>& png, const IccProfile& profile);
+    bool EmbedIccInJpeg(std::vector<uint8_t>& jpeg, const IccProfile& profile);
+}
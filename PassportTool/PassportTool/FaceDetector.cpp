@@ -0,0 +1,240 @@
+#include "FaceDetector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr int kWorkDim = 200;          // detector resolution (longest side)
+        constexpr double kFaceAspect = 0.78;   // face box width / height
+        constexpr double kHeadToFace = 1.30;   // chin-to-crown vs. brow-to-chin box
+        constexpr double kPi = 3.14159265358979323846;
+
+        // Summed-area table with a zero guard row/column: (w+1) x (h+1).
+        struct Integral
+        {
+            int w{ 0 }, h{ 0 };
+            std::vector<uint32_t> s;
+
+            template <typename Fn>
+            void Build(int width, int height, Fn&& value)
+            {
+                w = width; h = height;
+                s.assign(static_cast<size_t>(w + 1) * (h + 1), 0u);
+                for (int y = 0; y < h; ++y)
+                {
+                    uint32_t run = 0;
+                    uint32_t* cur = &s[static_cast<size_t>(y + 1) * (w + 1) + 1];
+                    const uint32_t* up = cur - (w + 1);
+                    for (int x = 0; x < w; ++x)
+                    {
+                        run += value(x, y);
+                        cur[x] = up[x] + run;
+                    }
+                }
+            }
+
+            // Sum over [x0,x1) x [y0,y1), clamped to the image.
+            uint32_t Sum(int x0, int y0, int x1, int y1) const
+            {
+                x0 = std::clamp(x0, 0, w); x1 = std::clamp(x1, 0, w);
+                y0 = std::clamp(y0, 0, h); y1 = std::clamp(y1, 0, h);
+                if (x1 <= x0 || y1 <= y0) return 0;
+                auto at = [&](int x, int y) { return s[static_cast<size_t>(y) * (w + 1) + x]; };
+                return at(x1, y1) - at(x0, y1) - at(x1, y0) + at(x0, y0);
+            }
+
+            double Mean(int x0, int y0, int x1, int y1) const
+            {
+                x0 = std::clamp(x0, 0, w); x1 = std::clamp(x1, 0, w);
+                y0 = std::clamp(y0, 0, h); y1 = std::clamp(y1, 0, h);
+                int area = (x1 - x0) * (y1 - y0);
+                return area > 0 ? static_cast<double>(Sum(x0, y0, x1, y1)) / area : 0.0;
+            }
+        };
+
+        // Chai & Ngan YCbCr skin box; cheap and good enough as a first stage.
+        bool IsSkin(const uint8_t* bgra)
+        {
+            int b = bgra[0], g = bgra[1], r = bgra[2];
+            int cb = 128 + ((-43 * r - 85 * g + 128 * b) >> 8);
+            int cr = 128 + ((128 * r - 107 * g - 21 * b) >> 8);
+            return cb >= 77 && cb <= 127 && cr >= 133 && cr <= 173;
+        }
+
+        struct Window
+        {
+            int x, y, w, h;
+            double score;
+            double contrast;
+        };
+
+        // Darkest horizontal band inside [x0,x1) x [y0,y1); returns its centre row.
+        int DarkestRow(const Integral& gray, int x0, int x1, int y0, int y1, int band)
+        {
+            int bestY = (y0 + y1) / 2;
+            double best = 1e30;
+            for (int y = y0; y + band <= y1; ++y)
+            {
+                double m = gray.Mean(x0, y, x1, y + band);
+                if (m < best) { best = m; bestY = y + band / 2; }
+            }
+            return bestY;
+        }
+
+        int DarkestCol(const Integral& gray, int x0, int x1, int y0, int y1, int band)
+        {
+            int bestX = (x0 + x1) / 2;
+            double best = 1e30;
+            for (int x = x0; x + band <= x1; ++x)
+            {
+                double m = gray.Mean(x, y0, x + band, y1);
+                if (m < best) { best = m; bestX = x + band / 2; }
+            }
+            return bestX;
+        }
+    }
+
+    FaceDetection DetectFace(const PixelBuffer& src)
+    {
+        FaceDetection result;
+        if (src.Empty()) return result;
+
+        int scale = 1;
+        PixelBuffer small = DownscaleColor(src, kWorkDim, &scale);
+        const int W = small.width;
+        const int H = small.height;
+        if (W < 16 || H < 16) return result;
+
+        Integral skin;
+        skin.Build(W, H, [&](int x, int y) -> uint32_t { return IsSkin(small.Row(y) + x * 4) ? 1u : 0u; });
+        Integral gray;
+        gray.Build(W, H, [&](int x, int y) -> uint32_t {
+            const uint8_t* p = small.Row(y) + x * 4;
+            return static_cast<uint32_t>((29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8);
+            });
+
+        // Cascade over windows: each stage is a handful of box sums and rejects
+        // most candidates before the next one runs.
+        Window best{ 0, 0, 0, 0, 0.0, 0.0 };
+        int maxH = std::min(H, static_cast<int>(W / kFaceAspect));
+        for (double fh = std::max(16.0, 0.15 * maxH); fh <= maxH; fh *= 1.12)
+        {
+            int h = static_cast<int>(fh);
+            int w = static_cast<int>(fh * kFaceAspect);
+            int step = std::max(1, h / 12);
+            int area = w * h;
+            int padX = w / 4, padY = h / 4;
+
+            for (int y = 0; y + h <= H; y += step)
+            {
+                for (int x = 0; x + w <= W; x += step)
+                {
+                    // Stage 1: the box must be mostly skin.
+                    double din = static_cast<double>(skin.Sum(x, y, x + w, y + h)) / area;
+                    if (din < 0.45) continue;
+
+                    // Stage 2: and noticeably more skin than its surround.
+                    int ox0 = std::max(0, x - padX), oy0 = std::max(0, y - padY);
+                    int ox1 = std::min(W, x + w + padX), oy1 = std::min(H, y + h + padY);
+                    int ringArea = (ox1 - ox0) * (oy1 - oy0) - area;
+                    double dring = ringArea > 0
+                        ? static_cast<double>(skin.Sum(ox0, oy0, ox1, oy1) - skin.Sum(x, y, x + w, y + h)) / ringArea
+                        : 0.0;
+                    double contrast = din - dring;
+                    if (contrast < 0.15) continue;
+
+                    // Stage 3: Haar-like two-band feature, eyes darker than cheeks.
+                    double eyes = gray.Mean(x + w / 8, y + h / 5, x + w - w / 8, y + (h * 9) / 20);
+                    double cheeks = gray.Mean(x + w / 8, y + h / 2, x + w - w / 8, y + (h * 7) / 10);
+                    double eyeContrast = cheeks - eyes;
+                    if (eyeContrast < 3.0) continue;
+
+                    double score = contrast * din * (1.0 + std::min(eyeContrast, 40.0) / 40.0);
+                    if (score > best.score)
+                        best = { x, y, w, h, score, contrast };
+                }
+            }
+        }
+
+        if (best.score <= 0.0) return result;
+
+        // Eye refinement: darkest band in each upper quadrant of the face box.
+        int band = std::max(1, best.h / 16);
+        int ey0 = best.y + (best.h * 3) / 20;
+        int ey1 = best.y + (best.h * 11) / 20;
+        int lx0 = best.x + best.w / 10, lx1 = best.x + best.w / 2;
+        int rx0 = best.x + best.w / 2, rx1 = best.x + best.w - best.w / 10;
+
+        int ly = DarkestRow(gray, lx0, lx1, ey0, ey1, band);
+        int ry = DarkestRow(gray, rx0, rx1, ey0, ey1, band);
+        int half = std::max(1, best.h / 14);
+        int lx = DarkestCol(gray, lx0, lx1, ly - half, ly + half, band);
+        int rx = DarkestCol(gray, rx0, rx1, ry - half, ry + half, band);
+
+        auto toSrc = [&](double v) { return (v + 0.5) * scale; };
+
+        result.found = true;
+        result.faceX = best.x * static_cast<double>(scale);
+        result.faceY = best.y * static_cast<double>(scale);
+        result.faceW = best.w * static_cast<double>(scale);
+        result.faceH = best.h * static_cast<double>(scale);
+        result.leftEyeX = toSrc(lx);  result.leftEyeY = toSrc(ly);
+        result.rightEyeX = toSrc(rx); result.rightEyeY = toSrc(ry);
+        result.confidence = std::clamp(best.contrast * 2.0, 0.0, 1.0);
+
+        double dx = result.rightEyeX - result.leftEyeX;
+        double dy = result.rightEyeY - result.leftEyeY;
+        double tilt = (dx > 0) ? std::atan2(dy, dx) * 180.0 / kPi : 0.0;
+        if (std::abs(tilt) > 20.0)
+        {
+            // Eye pair is implausible (glasses glare, hair); trust the box only.
+            tilt = 0.0;
+            double midY = (result.leftEyeY + result.rightEyeY) * 0.5;
+            result.leftEyeY = result.rightEyeY = midY;
+            result.confidence *= 0.5;
+        }
+        result.tiltDeg = tilt;
+        return result;
+    }
+
+    FaceDetection ScaleDetection(FaceDetection face, double scale)
+    {
+        face.faceX *= scale; face.faceY *= scale;
+        face.faceW *= scale; face.faceH *= scale;
+        face.leftEyeX *= scale; face.leftEyeY *= scale;
+        face.rightEyeX *= scale; face.rightEyeY *= scale;
+        return face;
+    }
+
+    CropProposal ProposeCrop(const FaceDetection& face, const PassportSpec& spec,
+        int srcW, int srcH, double viewportW, double viewportH)
+    {
+        CropProposal p;
+        if (!face.found || viewportW <= 0 || viewportH <= 0 || face.faceH <= 0) return p;
+
+        // Undo the head tilt; RotationSlider angles are clockwise-positive.
+        p.angleDeg = std::clamp(-face.tiltDeg, -20.0, 20.0);
+
+        // RotateTransform pivots on the image centre, so the eye midpoint
+        // moves with it; the scroll offsets must target the rotated point.
+        double cx = srcW * 0.5, cy = srcH * 0.5;
+        double ex = (face.leftEyeX + face.rightEyeX) * 0.5 - cx;
+        double ey = (face.leftEyeY + face.rightEyeY) * 0.5 - cy;
+        double th = p.angleDeg * kPi / 180.0;
+        double rx = cx + ex * std::cos(th) - ey * std::sin(th);
+        double ry = cy + ex * std::sin(th) + ey * std::cos(th);
+
+        double headFrac = (spec.headMin + spec.headMax) * 0.5;
+        double eyeFrac = (spec.eyeMin + spec.eyeMax) * 0.5;
+        double headPx = face.faceH * kHeadToFace;
+
+        p.zoom = std::clamp(headFrac * viewportH / headPx, 0.1, 10.0);
+        p.offsetX = rx * p.zoom - viewportW * 0.5;
+        p.offsetY = ry * p.zoom - viewportH * (1.0 - eyeFrac);
+        return p;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+// CPU face / eye-line locator used to pre-frame the crop viewport.
+//
+// Works on a small (≈200 px) area-averaged copy of the source so a 12 MP
+// photo costs one streaming pass plus a few thousand O(1) box queries on
+// integral images. No model files, no GPU.
+
+#include "PixelBuffer.h"
+
+namespace PassportTool::Core
+{
+    // Head-size and eye-line rules for a photo format, all expressed as a
+    // fraction of the final photo height so they are unit-independent.
+    struct PassportSpec
+    {
+        const wchar_t* name;
+        double headMin;   // chin-to-crown, min fraction of photo height
+        double headMax;   // chin-to-crown, max fraction of photo height
+        double eyeMin;    // eye line above bottom edge, min fraction
+        double eyeMax;    // eye line above bottom edge, max fraction
+    };
+
+    // US passport 2x2 in: head 1 - 1 3/8 in, eyes 1 1/8 - 1 3/8 in from bottom.
+    inline constexpr PassportSpec kSpecUs2x2{ L"US 2×2 in", 0.50, 0.69, 0.56, 0.69 };
+    // ICAO 35x45 mm (EU/Schengen): head 32 - 36 mm.
+    inline constexpr PassportSpec kSpecIcao35x45{ L"ICAO 35×45 mm", 0.71, 0.80, 0.60, 0.70 };
+
+    struct FaceDetection
+    {
+        bool found{ false };
+        double confidence{ 0 };          // 0..1
+
+        // Face box (brow to chin) in source pixels.
+        double faceX{ 0 }, faceY{ 0 }, faceW{ 0 }, faceH{ 0 };
+
+        // Eye centres in source pixels; "left" is image-left.
+        double leftEyeX{ 0 }, leftEyeY{ 0 };
+        double rightEyeX{ 0 }, rightEyeY{ 0 };
+
+        // Eye-line angle in degrees, positive when the image-right eye is
+        // lower (i.e. the head is tilted clockwise on screen).
+        double tiltDeg{ 0 };
+    };
+
+    // Pan/zoom/rotation for CropScrollViewer + RotationSlider.
+    struct CropProposal
+    {
+        double zoom{ 1 };
+        double offsetX{ 0 };
+        double offsetY{ 0 };
+        double angleDeg{ 0 };
+    };
+
+    FaceDetection DetectFace(const PixelBuffer& src);
+
+    // Maps a detection made on a reduced copy (e.g. a pyramid level) back to
+    // source pixels.
+    FaceDetection ScaleDetection(FaceDetection face, double scale);
+
+    // Maps a detection to viewport settings so the head height and eye line
+    // land in the middle of the spec's tolerance. The crop viewport shows the
+    // source at 1 DIP per pixel when zoom == 1 (Image Stretch="None").
+    CropProposal ProposeCrop(const FaceDetection& face, const PassportSpec& spec,
+        int srcW, int srcH, double viewportW, double viewportH);
+}
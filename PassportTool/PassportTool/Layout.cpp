@@ -0,0 +1,279 @@
+#include "Layout.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        int Round(double units, double ppu, bool down)
+        {
+            double px = units * ppu;
+            if (!(px > 0) || !std::isfinite(px)) return 0;
+            px = down ? std::floor(px + 1e-9) : std::floor(px + 0.5 + 1e-9);
+            return px > 1e9 ? 1000000000 : static_cast<int>(px);
+        }
+
+        // Stamps of size s that fit in D with a gap g before, between and after.
+        int64_t FitCount(int64_t D, int64_t s, int64_t g)
+        {
+            if (s <= 0 || D < s + 2 * g) return 0;
+            return (D - g) / (s + g);
+        }
+
+        // Unit lengths tried are multiples of either column pitch up to this
+        // many stamps per column; longer units only make the roll's tail coarser.
+        constexpr int64_t kMaxRollRows = 16;
+    }
+
+    int ToDevicePixels(double units, double ppu)
+    {
+        return Round(units, ppu, false);
+    }
+
+    PixelMetrics ToDevicePixels(double sheetW, double sheetH, double imgW, double imgH, double gap, double ppu)
+    {
+        PixelMetrics m;
+        m.sheetW = Round(sheetW, ppu, true);
+        m.sheetH = Round(sheetH, ppu, true);
+        m.cellW = Round(imgW, ppu, false);
+        m.cellH = Round(imgH, ppu, false);
+        m.gap = Round(gap, ppu, false);
+        return m;
+    }
+
+    LayoutResult CalculateOptimalPlacement(const PixelMetrics& m)
+    {
+        const int64_t g = m.gap;
+        const int64_t sW = m.sheetW, sH = m.sheetH;
+        const int64_t cW_n = m.cellW, cH_n = m.cellH;
+        const int64_t cW_r = m.cellH, cH_r = m.cellW;
+
+        auto gridCount = [&](int64_t aW, int64_t aH, int64_t cW, int64_t cH) -> int64_t {
+            return FitCount(aW, cW, g) * FitCount(aH, cH, g);
+            };
+
+        auto buildGrid = [&](std::vector<ImagePlacement>& out, int64_t ox, int64_t oy, int64_t aW, int64_t aH,
+            int64_t cW, int64_t cH, bool rot)
+            {
+                int64_t cols = FitCount(aW, cW, g);
+                int64_t rows = FitCount(aH, cH, g);
+                for (int64_t r = 0; r < rows; ++r)
+                    for (int64_t c = 0; c < cols; ++c)
+                        out.push_back({
+                            static_cast<int>(ox + g + c * (cW + g)),
+                            static_cast<int>(oy + g + r * (cH + g)),
+                            static_cast<int>(cW), static_cast<int>(cH), rot });
+            };
+
+        // Strictly-greater comparison keeps the first candidate on ties,
+        // in the order Normal, Rotated, Mix H (nR ascending), Mix V (nC ascending).
+        int64_t bestCount = 0;
+        LayoutKind bestKind = LayoutKind::None;
+        int64_t bestSplit = 0;
+
+        auto tryCandidate = [&](int64_t cnt, LayoutKind kind, int64_t split) {
+            if (cnt > bestCount) {
+                bestCount = cnt;
+                bestKind = kind;
+                bestSplit = split;
+            }
+            };
+
+        tryCandidate(gridCount(sW, sH, cW_n, cH_n), LayoutKind::Normal, 0);
+        tryCandidate(gridCount(sW, sH, cW_r, cH_r), LayoutKind::Rotated, 0);
+
+        if (cW_n != cH_n)
+        {
+            int64_t maxNR = FitCount(sH, cH_n, g);
+            int64_t maxNC = FitCount(sW, cW_n, g);
+
+            for (int64_t nR = 0; nR <= maxNR; ++nR) {
+                int64_t sy = nR * (cH_n + g);
+                tryCandidate(gridCount(sW, sy, cW_n, cH_n) + gridCount(sW, sH - sy, cW_r, cH_r),
+                    LayoutKind::MixH, nR);
+            }
+            for (int64_t nC = 0; nC <= maxNC; ++nC) {
+                int64_t sx = nC * (cW_n + g);
+                tryCandidate(gridCount(sx, sH, cW_n, cH_n) + gridCount(sW - sx, sH, cW_r, cH_r),
+                    LayoutKind::MixV, nC);
+            }
+        }
+
+        LayoutResult result;
+        result.kind = bestKind;
+        result.metrics = m;
+        if (bestCount <= 0) return result;
+        result.placements.reserve(static_cast<size_t>(bestCount));
+
+        switch (bestKind)
+        {
+        case LayoutKind::Normal:
+            buildGrid(result.placements, 0, 0, sW, sH, cW_n, cH_n, false);
+            break;
+        case LayoutKind::Rotated:
+            buildGrid(result.placements, 0, 0, sW, sH, cW_r, cH_r, true);
+            break;
+        case LayoutKind::MixH: {
+            int64_t sy = bestSplit * (cH_n + g);
+            buildGrid(result.placements, 0, 0, sW, sy, cW_n, cH_n, false);
+            buildGrid(result.placements, 0, sy, sW, sH - sy, cW_r, cH_r, true);
+            break;
+        }
+        case LayoutKind::MixV: {
+            int64_t sx = bestSplit * (cW_n + g);
+            buildGrid(result.placements, 0, 0, sx, sH, cW_n, cH_n, false);
+            buildGrid(result.placements, sx, 0, sW - sx, sH, cW_r, cH_r, true);
+            break;
+        }
+        default:
+            break;
+        }
+        return result;
+    }
+
+    LayoutResult CalculateOptimalPlacement(
+        double sheetW, double sheetH, double imgW, double imgH, double gap, double ppu)
+    {
+        return CalculateOptimalPlacement(ToDevicePixels(sheetW, sheetH, imgW, imgH, gap, ppu));
+    }
+
+    RollUnit CalculateRollUnit(const PixelMetrics& m)
+    {
+        const int64_t g = m.gap;
+        const int64_t W = m.sheetW;
+        const int64_t cW = m.cellW, cH = m.cellH;
+        // Pitch along the roll: an upright stamp is cH tall, a rotated one cW.
+        const int64_t pitchN = cH + g, pitchR = cW + g;
+
+        RollUnit unit;
+        unit.metrics = m;
+        if (W <= 0 || cW <= 0 || cH <= 0) return unit;
+
+        // Density k / U compared by cross-multiplication; ties keep the
+        // shorter unit, then the earlier candidate (Normal, Rotated, MixV).
+        int64_t bestK = 0, bestU = 1, bestCols = 0;
+        LayoutKind bestKind = LayoutKind::None;
+        auto tryCandidate = [&](int64_t k, int64_t U, LayoutKind kind, int64_t cols) {
+            if (k <= 0) return;
+            int64_t lhs = k * bestU, rhs = bestK * U;
+            if (lhs > rhs || (lhs == rhs && U < bestU)) {
+                bestK = k;
+                bestU = U;
+                bestKind = kind;
+                bestCols = cols;
+            }
+            };
+
+        const int64_t maxNC = FitCount(W, cW, g);
+        tryCandidate(maxNC, pitchN, LayoutKind::Normal, maxNC);
+        tryCandidate(FitCount(W, cH, g), pitchR, LayoutKind::Rotated, 0);
+
+        if (cW != cH)
+        {
+            std::vector<int64_t> lengths;
+            for (int64_t a = 1; a <= kMaxRollRows; ++a)
+            {
+                lengths.push_back(a * pitchN);
+                lengths.push_back(a * pitchR);
+            }
+            for (int64_t nC = 1; nC < maxNC; ++nC)
+            {
+                int64_t rC = FitCount(W - nC * (cW + g), cH, g);
+                if (rC <= 0) continue;
+                for (int64_t U : lengths)
+                    tryCandidate(nC * (U / pitchN) + rC * (U / pitchR), U, LayoutKind::MixV, nC);
+            }
+        }
+        if (bestKind == LayoutKind::None) return unit;
+
+        unit.kind = bestKind;
+        unit.length = static_cast<int>(bestU);
+        auto addColumns = [&](int64_t ox, int64_t cols, int64_t w, int64_t h, bool rot) {
+            int64_t rows = bestU / (h + g);
+            for (int64_t r = 0; r < rows; ++r)
+                for (int64_t c = 0; c < cols; ++c)
+                    unit.placements.push_back({
+                        static_cast<int>(ox + g + c * (w + g)),
+                        static_cast<int>(g + r * (h + g)),
+                        static_cast<int>(w), static_cast<int>(h), rot });
+            };
+        switch (bestKind)
+        {
+        case LayoutKind::Normal:
+            addColumns(0, maxNC, cW, cH, false);
+            break;
+        case LayoutKind::Rotated:
+            addColumns(0, FitCount(W, cH, g), cH, cW, true);
+            break;
+        default: {
+            int64_t sx = bestCols * (cW + g);
+            addColumns(0, bestCols, cW, cH, false);
+            addColumns(sx, FitCount(W - sx, cH, g), cH, cW, true);
+            break;
+        }
+        }
+
+        // A partial last unit then fills from the top, keeping the tail short.
+        std::stable_sort(unit.placements.begin(), unit.placements.end(),
+            [](const ImagePlacement& a, const ImagePlacement& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+        return unit;
+    }
+
+    RollLayout::RollLayout(RollUnit unit)
+        : m_unit(std::move(unit))
+    {
+        int bottom = 0;
+        for (const auto& p : m_unit.placements)
+        {
+            bottom = std::max(bottom, p.y + p.h);
+            m_prefixBottom.push_back(bottom);
+        }
+    }
+
+    ImagePlacement RollLayout::At(uint64_t index) const
+    {
+        const uint64_t k = m_unit.placements.size();
+        ImagePlacement p = m_unit.placements[index % k];
+        const uint64_t unitIndex = index / k;
+        const int64_t maxUnit = (INT_MAX - static_cast<int64_t>(p.y)) / m_unit.length;
+        p.y = unitIndex > static_cast<uint64_t>(maxUnit)
+            ? INT_MAX
+            : static_cast<int>(p.y + static_cast<int64_t>(unitIndex) * m_unit.length);
+        return p;
+    }
+
+    int64_t RollLayout::LengthFor(uint64_t count) const
+    {
+        if (count == 0 || Empty()) return 0;
+        const uint64_t k = m_unit.placements.size();
+        uint64_t last = count - 1;
+        return static_cast<int64_t>(last / k) * m_unit.length + m_prefixBottom[last % k] + m_unit.metrics.gap;
+    }
+
+    void RollLayout::PlacementsInRows(int64_t y0, int64_t y1, uint64_t count, std::vector<ImagePlacement>& out) const
+    {
+        if (Empty() || y1 <= y0 || count == 0) return;
+        const uint64_t k = m_unit.placements.size();
+        const int64_t U = m_unit.length;
+        // Every stamp of unit u lies within [u*U, (u+1)*U).
+        int64_t u0 = std::max<int64_t>(0, y0 / U);
+        int64_t u1 = (y1 - 1) / U;
+        for (int64_t u = u0; u <= u1; ++u)
+        {
+            uint64_t first = static_cast<uint64_t>(u) * k;
+            if (first >= count) break;
+            uint64_t n = std::min<uint64_t>(k, count - first);
+            int64_t base = u * U;
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                ImagePlacement p = m_unit.placements[i];
+                int64_t top = base + p.y;
+                if (top >= y1 || top + p.h <= y0) continue;
+                p.y = static_cast<int>(top - y0);
+                out.push_back(p);
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// Sheet layout search: how many stamps fit on a sheet, allowing a band of
+// 90°-rotated stamps below or beside the upright grid.
+//
+// Layout runs in whole device pixels. Physical sizes are converted once
+// (see ToDevicePixels), after which all arithmetic is integer, so every
+// stamp starts on a pixel boundary and results are identical on every
+// platform and run.
+
+#include <cstdint>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    struct ImagePlacement
+    {
+        int x;          // left edge in device pixels
+        int y;          // top edge in device pixels
+        int w;          // width in device pixels (on sheet)
+        int h;          // height in device pixels (on sheet)
+        bool rotated;   // true = image content is rotated 90 degrees
+    };
+
+    // Sheet and cell geometry in device pixels.
+    struct PixelMetrics
+    {
+        int sheetW{ 0 };
+        int sheetH{ 0 };
+        int cellW{ 0 };     // upright stamp
+        int cellH{ 0 };
+        int gap{ 0 };
+    };
+
+    // Rounding policy for user units -> device pixels:
+    //  - stamp sizes and the gap round to the nearest pixel, so a stamp's
+    //    printed size is within ±0.5 px (±0.5 / ppu units; 0.042 mm at
+    //    300 DPI) of the requested size;
+    //  - the sheet rounds down, so placements never run off the paper.
+    // Products are nudged by 1e-9 before rounding so values like 1.378 * 300
+    // that land a hair under .5 in binary round the way they read.
+    int ToDevicePixels(double units, double ppu);
+    PixelMetrics ToDevicePixels(double sheetW, double sheetH, double imgW, double imgH, double gap, double ppu);
+
+    enum class LayoutKind
+    {
+        None,
+        Normal,     // all upright
+        Rotated,    // all rotated
+        MixH,       // upright rows on top, rotated rows below
+        MixV,       // upright columns on the left, rotated columns right
+    };
+
+    struct LayoutResult
+    {
+        std::vector<ImagePlacement> placements;
+        LayoutKind kind{ LayoutKind::None };
+        PixelMetrics metrics;
+    };
+
+    // Candidates are counted analytically and only the winner is
+    // materialised, so the search is O(rows + cols) rather than O(stamps²).
+    LayoutResult CalculateOptimalPlacement(const PixelMetrics& metrics);
+
+    // Convenience: sizes in user units (in or cm); ppu = pixels per unit.
+    LayoutResult CalculateOptimalPlacement(
+        double sheetW, double sheetH, double imgW, double imgH, double gap, double ppu);
+
+    // ────────────────────────────────────────────────────────────────
+    // Roll media: fixed width, unbounded length
+    // ────────────────────────────────────────────────────────────────
+
+    // The repeating unit of a roll: columns of upright stamps beside columns
+    // of rotated stamps, over a length chosen so both column kinds waste
+    // little. Units abut down the roll; the roll opens with one gap.
+    struct RollUnit
+    {
+        std::vector<ImagePlacement> placements;     // y relative to the unit, sorted by y then x
+        int length{ 0 };                            // unit pitch along the roll
+        LayoutKind kind{ LayoutKind::None };        // Normal, Rotated or MixV
+        PixelMetrics metrics;                       // sheetW is the roll width; sheetH is unused
+    };
+
+    // Searched once per settings change: the unit with the most stamps per
+    // pixel of roll, shorter units winning ties.
+    RollUnit CalculateRollUnit(const PixelMetrics& metrics);
+
+    // Placements for any number of stamps, generated from the unit on demand.
+    class RollLayout
+    {
+    public:
+        RollLayout() = default;
+        explicit RollLayout(RollUnit unit);
+
+        const RollUnit& Unit() const { return m_unit; }
+        bool Empty() const { return m_unit.placements.empty(); }
+
+        // Stamp `index` counted down the roll (absolute y). y is an int, so
+        // only stamps of a roll whose LengthFor() fits in int are placed
+        // exactly; beyond that y saturates at INT_MAX instead of wrapping.
+        // StreamRoll rejects such rolls.
+        ImagePlacement At(uint64_t index) const;
+
+        // Roll length holding the first `count` stamps, closing gap included.
+        int64_t LengthFor(uint64_t count) const;
+
+        // Appends those of the first `count` stamps that overlap rows
+        // [y0, y1), with y relative to y0 so long rolls stay in int range.
+        void PlacementsInRows(int64_t y0, int64_t y1, uint64_t count, std::vector<ImagePlacement>& out) const;
+
+    private:
+        RollUnit m_unit;
+        std::vector<int> m_prefixBottom;    // max bottom edge over the unit's first i+1 stamps
+    };
+}
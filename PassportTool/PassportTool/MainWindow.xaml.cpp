@@ -8,6 +8,10 @@
 #include <vector>
 #include <iomanip>
 #include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
 
 using namespace winrt;
 using namespace Microsoft::UI::Xaml;
@@ -17,6 +21,7 @@ using namespace Microsoft::UI::Xaml::Media::Imaging;
 using namespace Microsoft::UI::Xaml::Input;
 using namespace winrt::Windows::Storage;
 using namespace winrt::Windows::Storage::Pickers;
+using namespace winrt::Windows::Storage::AccessCache;
 using namespace winrt::Windows::Graphics::Imaging;
 using namespace winrt::Windows::Storage::Streams;
 using namespace winrt::Windows::ApplicationModel::DataTransfer;
@@ -24,6 +29,128 @@ using namespace winrt::Windows::Globalization::NumberFormatting;
 
 namespace winrt::PassportTool::implementation
 {
+    namespace
+    {
+        using TraceSpan = ::PassportTool::Core::TraceSpan;
+        using TaskPriority = ::PassportTool::Core::TaskPriority;
+
+        // Stamps drawn in the roll preview; the full count is only streamed.
+        constexpr uint64_t kRollPreviewStamps = 48;
+
+        // co_await ResumeOnPool{ priority } continues the coroutine on a
+        // TaskScheduler worker. Pixel stages run there; only the final commit
+        // of results goes back through resume_foreground.
+        struct ResumeOnPool
+        {
+            TaskPriority priority;
+
+            bool await_ready() const noexcept { return false; }
+            template <typename Handle>
+            void await_suspend(Handle handle) const
+            {
+                ::PassportTool::Core::TaskScheduler::Shared().Submit(priority, [handle]() {
+                    // Workers are plain threads; WinRT calls need an apartment.
+                    thread_local bool apartment = (winrt::init_apartment(), true);
+                    (void)apartment;
+                    handle();
+                    });
+            }
+            void await_resume() const noexcept {}
+        };
+
+        // SoftwareBitmap (Bgra8) -> portable buffer for the CPU stages.
+        ::PassportTool::Core::PixelBuffer ToPixelBuffer(SoftwareBitmap const& bmp)
+        {
+            ::PassportTool::Core::PixelBuffer out(bmp.PixelWidth(), bmp.PixelHeight());
+            Buffer buffer(static_cast<uint32_t>(out.data.size()));
+            bmp.CopyToBuffer(buffer);
+            std::memcpy(out.data.data(), buffer.data(),
+                std::min<size_t>(buffer.Length(), out.data.size()));
+            return out;
+        }
+
+        SoftwareBitmap FromPixelBuffer(::PassportTool::Core::PixelBuffer const& pixels)
+        {
+            Buffer buffer(static_cast<uint32_t>(pixels.data.size()));
+            std::memcpy(buffer.data(), pixels.data.data(), pixels.data.size());
+            buffer.Length(static_cast<uint32_t>(pixels.data.size()));
+            return SoftwareBitmap::CreateCopyFromBuffer(buffer, BitmapPixelFormat::Bgra8,
+                pixels.width, pixels.height, BitmapAlphaMode::Premultiplied);
+        }
+
+        // Cache hit -> bitmap: one copy out of the mapping, no decode.
+        SoftwareBitmap FromMapped(::PassportTool::Core::MappedPixels const& pixels)
+        {
+            Buffer buffer(static_cast<uint32_t>(pixels.Bytes()));
+            std::memcpy(buffer.data(), pixels.Data(), pixels.Bytes());
+            buffer.Length(static_cast<uint32_t>(pixels.Bytes()));
+            return SoftwareBitmap::CreateCopyFromBuffer(buffer, BitmapPixelFormat::Bgra8,
+                pixels.Width(), pixels.Height(), BitmapAlphaMode::Premultiplied);
+        }
+
+        constexpr uint64_t kCacheCapacity = 2ull << 30;   // decoded pixels kept on disk
+        constexpr int kPyramidMinDim = 256;
+        constexpr int kAnalysisMinDim = 1024;   // detection downsamples further anyway
+
+        // Level 0 is the full-resolution decoded source after quarterTurns.
+        uint64_t SourceLevelKey(uint64_t source, int quarterTurns, int level)
+        {
+            using ::PassportTool::Core::HashCombine;
+            return HashCombine(HashCombine(source, static_cast<uint64_t>(quarterTurns)),
+                0x100 + static_cast<uint64_t>(level));
+        }
+
+        uint64_t StampKey(uint64_t source, int quarterTurns,
+            ::PassportTool::Core::CropTransform const& crop, int w, int h)
+        {
+            using ::PassportTool::Core::HashCombine;
+            const double v[] = { crop.zoom, crop.offsetX, crop.offsetY, crop.angleDeg, crop.viewportW, crop.viewportH };
+            uint64_t k = ::PassportTool::Core::HashBytes(v, sizeof(v), source);
+            k = HashCombine(k, static_cast<uint64_t>(quarterTurns));
+            return HashCombine(k, (static_cast<uint64_t>(w) << 32) | static_cast<uint32_t>(h));
+        }
+
+        std::string HexKey(uint64_t v)
+        {
+            char buf[17];
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+            return buf;
+        }
+
+        // Smallest cached pyramid level that is still >= kAnalysisMinDim.
+        std::shared_ptr<const ::PassportTool::Core::PixelBuffer> FindAnalysisLevel(
+            ::PassportTool::Core::PixelCache& cache, uint64_t source, int quarterTurns)
+        {
+            std::shared_ptr<const ::PassportTool::Core::MappedPixels> best;
+            for (int level = 1; ; ++level)
+            {
+                auto m = cache.Find(SourceLevelKey(source, quarterTurns, level));
+                if (!m || std::max(m->Width(), m->Height()) < kAnalysisMinDim) break;
+                best = std::move(m);
+            }
+            if (!best) return nullptr;
+            return std::make_shared<const ::PassportTool::Core::PixelBuffer>(best->ToPixelBuffer());
+        }
+
+        // Project files reference images by future-access token first (works
+        // after restarts in the packaged app), then by path.
+        winrt::Windows::Foundation::IAsyncOperation<StorageFile> ResolveFile(std::string token, std::string path)
+        {
+            auto list = StorageApplicationPermissions::FutureAccessList();
+            if (!token.empty() && list.ContainsItem(to_hstring(token)))
+            {
+                try { co_return co_await list.GetFileAsync(to_hstring(token)); }
+                catch (hresult_error const&) {}
+            }
+            if (!path.empty())
+            {
+                try { co_return co_await StorageFile::GetFileFromPathAsync(to_hstring(path)); }
+                catch (hresult_error const&) {}
+            }
+            co_return nullptr;
+        }
+    }
+
     // ──────────────────────────────────────────────────────────────
     // Construction & Initialisation
     // ──────────────────────────────────────────────────────────────
@@ -32,6 +159,7 @@ namespace winrt::PassportTool::implementation
     {
         InitializeComponent();
         m_isLoaded = false;
+        ::PassportTool::Core::SetTraceThreadName("UI");
 
         // Number-box formatting: 2 decimal places, round half-up
         DecimalFormatter formatter;
@@ -52,8 +180,10 @@ namespace winrt::PassportTool::implementation
         // Rotation Slider logic is handled in OnRotationChanged.
     }
 
-    void MainWindow::Log([[maybe_unused]] winrt::hstring const& message)
+    void MainWindow::Log(winrt::hstring const& message)
     {
+        // Release builds keep log lines as instant events in the trace.
+        ::PassportTool::Core::TraceMessage(winrt::to_string(message));
 #ifdef _DEBUG
         std::wstring msg = L"[PassportTool] " + std::wstring(message) + L"\r\n";
         OutputDebugStringW(msg.c_str());
@@ -113,9 +243,18 @@ namespace winrt::PassportTool::implementation
         txtCell.Text(L"Cell: " + to_hstring(imgW) + L" \u00D7 " + to_hstring(imgH) + L" " + unit);
     }
 
+    double MainWindow::GetOutputDpi()
+    {
+        constexpr double kDefaultDpi = 300.0;
+        auto box = NbDpi();
+        if (!box) return kDefaultDpi;
+        double dpi = box.Value();
+        return (std::isnan(dpi) || dpi <= 0) ? kDefaultDpi : dpi;
+    }
+
     double MainWindow::GetPixelsPerUnit()
     {
-        constexpr double dpi = 300.0;
+        double dpi = GetOutputDpi();
         if (RadioCm())
         {
             auto c = RadioCm().IsChecked();
@@ -124,6 +263,12 @@ namespace winrt::PassportTool::implementation
         return dpi;
     }
 
+    bool MainWindow::IsRollMode()
+    {
+        auto box = ChkRollMode();
+        return box && box.IsChecked() && box.IsChecked().Value();
+    }
+
     // ──────────────────────────────────────────────────────────────
     // Settings events
     // ──────────────────────────────────────────────────────────────
@@ -163,6 +308,34 @@ namespace winrt::PassportTool::implementation
         RegeneratePreviewGrid();
     }
 
+    // Roll media fixes only the width: the height box gives way to a stamp
+    // count and the preview grows with the roll.
+    void MainWindow::UpdateRollModeUi()
+    {
+        bool roll = IsRollMode();
+        if (NbSheetH()) NbSheetH().Visibility(roll ? Visibility::Collapsed : Visibility::Visible);
+        if (NbRollCount()) NbRollCount().Visibility(roll ? Visibility::Visible : Visibility::Collapsed);
+        if (NbSheetW()) NbSheetW().Header(box_value(roll ? L"Roll Width" : L"Sheet Width"));
+    }
+
+    void MainWindow::OnRollModeChanged(IInspectable const&, RoutedEventArgs const&)
+    {
+        UpdateRollModeUi();
+        if (!m_isLoaded) return;
+        UpdateSheetSize();
+        RegeneratePreviewGrid();
+    }
+
+    // The stamp is captured at the output DPI and the sharpening radius is
+    // physical, so a DPI change re-captures the stamp as well.
+    winrt::fire_and_forget MainWindow::OnDpiChanged(NumberBox const& sender, NumberBoxValueChangedEventArgs const& args)
+    {
+        OnSettingsChanged(sender, args);
+        if (!m_isLoaded || std::isnan(args.NewValue()) || !m_capturedStamp) co_return;
+        auto strong = get_strong();
+        co_await CaptureStamp();
+    }
+
     void MainWindow::UpdateSheetSize()
     {
         if (!m_isLoaded) return;
@@ -171,13 +344,13 @@ namespace winrt::PassportTool::implementation
         auto sh = NbSheetH();
         if (!grid || !sw || !sh) return;
 
-        double w = sw.Value() * GetPixelsPerUnit();
-        double h = sh.Value() * GetPixelsPerUnit();
-        if (std::isnan(w) || std::isnan(h)) return;
-        if (w < 1) w = 1;
-        if (h < 1) h = 1;
-        grid.Width(w);
-        grid.Height(h);
+        // In roll mode the height follows the layout (RegeneratePreviewGrid).
+        bool roll = IsRollMode();
+        if (std::isnan(sw.Value()) || (!roll && std::isnan(sh.Value()))) return;
+        // Whole device pixels, rounded down like the layout's sheet.
+        auto m = ::PassportTool::Core::ToDevicePixels(sw.Value(), roll ? 0 : sh.Value(), 0, 0, 0, GetPixelsPerUnit());
+        grid.Width(std::max(1, m.sheetW));
+        if (!roll) grid.Height(std::max(1, m.sheetH));
     }
 
     // ──────────────────────────────────────────────────────────────
@@ -221,91 +394,66 @@ namespace winrt::PassportTool::implementation
     std::vector<ImagePlacement> MainWindow::CalculateOptimalPlacement(
         double sheetW, double sheetH, double imgW, double imgH, double gap)
     {
-        double ppu = GetPixelsPerUnit();
-        double g = gap * ppu;
-        double sWpx = sheetW * ppu;
-        double sHpx = sheetH * ppu;
-
-        double cW_n = imgW * ppu;
-        double cH_n = imgH * ppu;
-        double cW_r = imgH * ppu;
-        double cH_r = imgW * ppu;
-
-        auto fitCount = [](double D, double s, double g) -> int {
-            if (s <= 0 || D < s + 2.0 * g) return 0;
-            return static_cast<int>(std::floor((D - g) / (s + g)));
-            };
+        TraceSpan span("layout");
+        auto layout = ::PassportTool::Core::CalculateOptimalPlacement(
+            sheetW, sheetH, imgW, imgH, gap, GetPixelsPerUnit());
+        span.End();
 
-        auto buildGrid = [&](double ox, double oy, double aW, double aH,
-            double cW, double cH, bool rot) -> std::vector<ImagePlacement>
+        if (TxtLayoutInfo())
+        {
+            hstring suffix;
+            switch (layout.kind)
             {
-                int cols = fitCount(aW, cW, g);
-                int rows = fitCount(aH, cH, g);
-                std::vector<ImagePlacement> out;
-                if (cols <= 0 || rows <= 0) return out;
-                out.reserve(static_cast<size_t>(rows) * cols);
-                for (int r = 0; r < rows; ++r)
-                    for (int c = 0; c < cols; ++c)
-                        out.push_back({
-                            ox + g + c * (cW + g),
-                            oy + g + r * (cH + g),
-                            cW, cH, rot });
-                return out;
-            };
-
-        auto bandH = [&](int n, double cH) -> double { return (n <= 0) ? 0.0 : n * (cH + g); };
-        auto bandW = [&](int n, double cW) -> double { return (n <= 0) ? 0.0 : n * (cW + g); };
+            case ::PassportTool::Core::LayoutKind::Normal:  suffix = L" (N)"; break;
+            case ::PassportTool::Core::LayoutKind::Rotated: suffix = L" (R)"; break;
+            case ::PassportTool::Core::LayoutKind::MixH:    suffix = L" (Mix H)"; break;
+            case ::PassportTool::Core::LayoutKind::MixV:    suffix = L" (Mix V)"; break;
+            default: break;
+            }
+            TxtLayoutInfo().Text(layout.placements.empty()
+                ? hstring(L"No fit")
+                : to_hstring(static_cast<int>(layout.placements.size())) + suffix);
+        }
 
-        int bestCount = 0;
-        std::vector<ImagePlacement> best;
-        hstring bestDesc;
+        return std::move(layout.placements);
+    }
 
-        auto tryCandidate = [&](std::vector<ImagePlacement>& p, hstring desc) {
-            int cnt = static_cast<int>(p.size());
-            if (cnt > bestCount) {
-                bestCount = cnt;
-                best = std::move(p);
-                bestDesc = desc;
-            }
-            };
+    std::vector<ImagePlacement> MainWindow::CalculateRollPlacement(
+        double rollW, double imgW, double imgH, double gap, uint64_t count)
+    {
+        TraceSpan span("layout.roll");
+        double ppu = GetPixelsPerUnit();
+        m_roll = ::PassportTool::Core::RollLayout(::PassportTool::Core::CalculateRollUnit(
+            ::PassportTool::Core::ToDevicePixels(rollW, 0, imgW, imgH, gap, ppu)));
+        m_rollCount = m_roll.Empty() ? 0 : count;
+        span.End();
 
-        {
-            auto p = buildGrid(0, 0, sWpx, sHpx, cW_n, cH_n, false);
-            tryCandidate(p, to_hstring((int)p.size()) + L" (N)");
-        }
-        {
-            auto p = buildGrid(0, 0, sWpx, sHpx, cW_r, cH_r, true);
-            tryCandidate(p, to_hstring((int)p.size()) + L" (R)");
-        }
+        // The preview is capped; saving and printing stream the full count.
+        uint64_t shown = std::min<uint64_t>(m_rollCount, kRollPreviewStamps);
+        std::vector<ImagePlacement> placements;
+        placements.reserve(static_cast<size_t>(shown));
+        for (uint64_t i = 0; i < shown; ++i) placements.push_back(m_roll.At(i));
 
-        bool isSquare = std::abs(imgW - imgH) < 0.001;
-        if (!isSquare)
+        if (TxtLayoutInfo())
         {
-            int maxNR = fitCount(sHpx, cH_n, g);
-            int maxRR = fitCount(sHpx, cH_r, g);
-            int maxNC = fitCount(sWpx, cW_n, g);
-            int maxRC = fitCount(sWpx, cW_r, g);
-
-            for (int nR = 0; nR <= maxNR; ++nR) {
-                double sy = bandH(nR, cH_n);
-                auto pT = buildGrid(0, 0, sWpx, sy, cW_n, cH_n, false);
-                auto pB = buildGrid(0, sy, sWpx, sHpx - sy, cW_r, cH_r, true);
-                pT.insert(pT.end(), pB.begin(), pB.end());
-                tryCandidate(pT, to_hstring((int)pT.size()) + L" (Mix H)");
-            }
-            for (int nC = 0; nC <= maxNC; ++nC) {
-                double sx = bandW(nC, cW_n);
-                auto pL = buildGrid(0, 0, sx, sHpx, cW_n, cH_n, false);
-                auto pR = buildGrid(sx, 0, sWpx - sx, sHpx, cW_r, cH_r, true);
-                pL.insert(pL.end(), pR.begin(), pR.end());
-                tryCandidate(pL, to_hstring((int)pL.size()) + L" (Mix V)");
+            const auto& unit = m_roll.Unit();
+            hstring suffix;
+            switch (unit.kind)
+            {
+            case ::PassportTool::Core::LayoutKind::Normal:  suffix = L" (N)"; break;
+            case ::PassportTool::Core::LayoutKind::Rotated: suffix = L" (R)"; break;
+            case ::PassportTool::Core::LayoutKind::MixV:    suffix = L" (Mix V)"; break;
+            default: break;
             }
+            bool cm = RadioCm() && RadioCm().IsChecked() && RadioCm().IsChecked().Value();
+            wchar_t length[32];
+            swprintf(length, 32, L"%.1f %s", static_cast<double>(m_roll.LengthFor(m_rollCount)) / ppu, cm ? L"cm" : L"in");
+            TxtLayoutInfo().Text(m_roll.Empty()
+                ? hstring(L"No fit")
+                : to_hstring(static_cast<int>(unit.placements.size())) + L"/unit" + suffix + L" \u00B7 " + length);
         }
 
-        if (TxtLayoutInfo())
-            TxtLayoutInfo().Text(bestCount > 0 ? bestDesc : L"No fit");
-
-        return best;
+        return placements;
     }
 
     // ──────────────────────────────────────────────────────────────
@@ -316,6 +464,7 @@ namespace winrt::PassportTool::implementation
     {
         if (!m_isLoaded) co_return;
         auto strong = get_strong();
+        TraceSpan span("preview.regenerate");
 
         auto grid = PreviewGrid();
         if (!grid) co_return;
@@ -344,9 +493,23 @@ namespace winrt::PassportTool::implementation
 
         if (std::isnan(sheetW) || std::isnan(sheetH) || std::isnan(imgW) ||
             std::isnan(imgH) || std::isnan(gap)) co_return;
+        bool roll = IsRollMode();
+        if (roll) sheetH = 1;   // unused; the roll length follows the count
         if (sheetW <= 0 || sheetH <= 0 || imgW <= 0 || imgH <= 0 || gap < 0) co_return;
 
-        m_currentPlacements = CalculateOptimalPlacement(sheetW, sheetH, imgW, imgH, gap);
+        if (roll)
+        {
+            double count = NbRollCount() ? NbRollCount().Value() : 0;
+            if (std::isnan(count) || count < 1) co_return;
+            m_currentPlacements = CalculateRollPlacement(sheetW, imgW, imgH, gap, static_cast<uint64_t>(count));
+            auto shown = static_cast<uint64_t>(m_currentPlacements.size());
+            grid.Height(static_cast<double>(std::max<int64_t>(1, m_roll.LengthFor(shown))));
+        }
+        else
+        {
+            m_rollCount = 0;
+            m_currentPlacements = CalculateOptimalPlacement(sheetW, sheetH, imgW, imgH, gap);
+        }
 
         if (!m_croppedStamp || m_currentPlacements.empty()) co_return;
 
@@ -357,7 +520,11 @@ namespace winrt::PassportTool::implementation
 
             Image img;
             SoftwareBitmapSource src;
-            try { co_await src.SetBitmapAsync(bmp); }
+            try
+            {
+                TraceSpan set("preview.set_bitmap");
+                co_await src.SetBitmapAsync(bmp);
+            }
             catch (hresult_error const&) { continue; }
 
             img.Source(src);
@@ -371,7 +538,7 @@ namespace winrt::PassportTool::implementation
             outline.Height(p.h);
             outline.HorizontalAlignment(HorizontalAlignment::Left);
             outline.VerticalAlignment(VerticalAlignment::Top);
-            outline.Margin({ p.x, p.y, 0, 0 });
+            outline.Margin({ static_cast<double>(p.x), static_cast<double>(p.y), 0, 0 });
             outline.Child(img);
 
             grid.Children().Append(outline);
@@ -393,18 +560,164 @@ namespace winrt::PassportTool::implementation
     // ──────────────────────────────────────────────────────────────
 
     winrt::fire_and_forget MainWindow::BtnApplyCrop_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        auto strong = get_strong();
+        co_await CaptureStamp();
+    }
+
+    // Captures the crop viewport at the output resolution and commits it.
+    winrt::Windows::Foundation::IAsyncAction MainWindow::CaptureStamp()
     {
         if (!m_originalBitmap) co_return;
         auto strong = get_strong();
 
+        auto crop = CurrentCropTransform();
         auto stamp = co_await CaptureCropAsBitmap();
         if (!stamp) co_return;
 
+        m_capturedStamp = stamp;
+        m_stampKey = StampKey(m_sourceKey, m_quarterTurns, crop, stamp.PixelWidth(), stamp.PixelHeight());
+        CacheStamp(stamp, m_stampKey);
+        co_await CommitStamp();
+    }
+
+    // Runs the per-stamp CPU stages on the last capture and publishes the
+    // result as m_croppedStamp / m_croppedStampRotated.
+    winrt::Windows::Foundation::IAsyncAction MainWindow::CommitStamp()
+    {
+        auto strong = get_strong();
+        auto captured = m_capturedStamp;
+        auto dq = this->DispatcherQueue();
+        if (!captured || !dq) co_return;
+        TraceSpan span("stamp.commit");
+        // Option changes each start a commit for the same capture and they
+        // finish in any order; only the most recent one may publish.
+        uint64_t generation = ++m_commitGeneration;
+
+        bool whiten = ChkWhiteBackground() && ChkWhiteBackground().IsChecked() &&
+            ChkWhiteBackground().IsChecked().Value();
+        auto colorTransform = m_printTransform;
+        auto media = static_cast<::PassportTool::Core::PrintMedia>(
+            CbPrintMedia() ? std::max(0, CbPrintMedia().SelectedIndex()) : 0);
+        double dpi = GetOutputDpi();
+        bool sharpen = media != ::PassportTool::Core::PrintMedia::None;
+
+        // Every stage, the rotated copy included, runs on the pool; the UI
+        // thread only publishes the finished pair.
+        co_await ResumeOnPool{ TaskPriority::Interactive };
+        auto pixels = ToPixelBuffer(captured);
+        SoftwareBitmap stamp = captured;
+        if (whiten || sharpen || colorTransform)
+        {
+            if (whiten)
+            {
+                TraceSpan stage("stamp.background");
+                double share = ::PassportTool::Core::ReplaceBackground(pixels);
+                stage.End();
+                Log(L"Background replaced: " + to_hstring(share * 100.0) + L"%");
+            }
+            if (sharpen)
+            {
+                TraceSpan stage("stamp.sharpen");
+                ::PassportTool::Core::SharpenForPrint(pixels, media, dpi);
+            }
+            // Printer colour conversion last, once per stamp; placements reuse it.
+            if (colorTransform)
+            {
+                TraceSpan stage("stamp.color");
+                colorTransform->Apply(pixels);
+            }
+            stamp = FromPixelBuffer(pixels);
+        }
+        TraceSpan rotate("rotate");
+        auto rotated = FromPixelBuffer(::PassportTool::Core::Rotate90(pixels));
+        rotate.End();
+        co_await winrt::resume_foreground(dq);
+
+        if (generation != m_commitGeneration) co_return;   // a newer commit is in flight
         m_croppedStamp = stamp;
-        m_croppedStampRotated = co_await RotateBitmap90(stamp);
+        m_croppedStampRotated = rotated;
+        m_croppedStampColor = colorTransform
+            ? ::PassportTool::Core::RasterColor::DeviceRgb : ::PassportTool::Core::RasterColor::Srgb;
         co_await RegeneratePreviewGrid();
     }
 
+    winrt::fire_and_forget MainWindow::BtnPrinterProfile_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        auto strong = get_strong();
+        FileOpenPicker picker;
+        auto initWnd{ picker.as<::IInitializeWithWindow>() };
+        HWND hwnd;
+        auto windowNative{ this->try_as<::IWindowNative>() };
+        windowNative->get_WindowHandle(&hwnd);
+        initWnd->Initialize(hwnd);
+        picker.FileTypeFilter().ReplaceAll({ L".icc", L".icm" });
+        StorageFile file = co_await picker.PickSingleFileAsync();
+
+        // Cancelling the picker goes back to plain sRGB output.
+        co_await ApplyPrinterProfile(file);
+    }
+
+    // Loads `file` as the printer profile (null = plain sRGB) and reprocesses
+    // the current stamp.
+    winrt::Windows::Foundation::IAsyncAction MainWindow::ApplyPrinterProfile(StorageFile file)
+    {
+        auto strong = get_strong();
+        m_printerProfileFile = nullptr;
+        m_printerProfile.reset();
+        m_printTransform = nullptr;
+        hstring label = L"Output: sRGB";
+
+        if (file)
+        {
+            try
+            {
+                auto buffer = co_await FileIO::ReadBufferAsync(file);
+                std::vector<uint8_t> bytes(buffer.data(), buffer.data() + buffer.Length());
+                std::string error;
+                auto profile = ::PassportTool::Core::IccProfile::Parse(std::move(bytes), &error);
+                if (profile)
+                {
+                    auto dq = this->DispatcherQueue();
+                    co_await ResumeOnPool{ TaskPriority::Interactive };
+                    auto xf = ::PassportTool::Core::ColorTransform::Get(
+                        ::PassportTool::Core::IccProfile::Srgb(), *profile);
+                    co_await winrt::resume_foreground(dq);
+
+                    m_printerProfile = std::move(profile);
+                    m_printTransform = xf;
+                    m_printerProfileFile = file;
+                    label = L"Output: " + file.Name();
+                }
+                else
+                {
+                    Log(L"Printer profile rejected: " + to_hstring(error));
+                    label = L"Output: sRGB (profile not supported)";
+                }
+            }
+            catch (hresult_error const& ex) {
+                Log(L"Printer profile load failed: " + ex.message());
+            }
+        }
+
+        if (auto txt = TxtPrinterProfile()) txt.Text(label);
+        if (m_capturedStamp) co_await CommitStamp();
+    }
+
+    winrt::fire_and_forget MainWindow::OnBackgroundOptionChanged(IInspectable const&, RoutedEventArgs const&)
+    {
+        if (!m_capturedStamp) co_return;
+        auto strong = get_strong();
+        co_await CommitStamp();
+    }
+
+    winrt::fire_and_forget MainWindow::OnPrintMediaChanged(IInspectable const&, SelectionChangedEventArgs const&)
+    {
+        if (!m_capturedStamp) co_return;
+        auto strong = get_strong();
+        co_await CommitStamp();
+    }
+
     // UPDATED: Now uses RenderTargetBitmap to capture exactly what is seen in the crop window (WYSIWYG)
     // allowing for rotation and arbitrary panning.
     winrt::Windows::Foundation::IAsyncOperation<SoftwareBitmap> MainWindow::CaptureCropAsBitmap()
@@ -418,11 +731,12 @@ namespace winrt::PassportTool::implementation
         auto imgHBox = NbImageH();
         if (!imgWBox || !imgHBox) co_return nullptr;
 
-        // Calculate target high-resolution dimensions (300 DPI)
+        // Calculate target high-resolution dimensions (output DPI, 300 by default)
         // This ensures the capture is not just screen resolution (96 DPI)
         double ppu = GetPixelsPerUnit();
-        int targetW = static_cast<int>(std::round(imgWBox.Value() * ppu));
-        int targetH = static_cast<int>(std::round(imgHBox.Value() * ppu));
+        // Same rounding as the layout cells, so the stamp blits 1:1.
+        int targetW = ::PassportTool::Core::ToDevicePixels(imgWBox.Value(), ppu);
+        int targetH = ::PassportTool::Core::ToDevicePixels(imgHBox.Value(), ppu);
 
         if (targetW <= 0 || targetH <= 0) co_return nullptr;
 
@@ -433,16 +747,26 @@ namespace winrt::PassportTool::implementation
 
             // Note: RenderAsync with scaled dimensions asks WinUI to re-rasterize the content 
             // at that resolution. For high-res images, this maintains quality.
+            TraceSpan render("capture.render");
             co_await rtb.RenderAsync(scroller, targetW, targetH);
+            render.End();
 
+            TraceSpan readback("capture.get_pixels");
             auto buffer = co_await rtb.GetPixelsAsync();
+            int width = rtb.PixelWidth();
+            int height = rtb.PixelHeight();
 
+            // Rendering needs the UI thread; the copy out does not.
+            auto dq = this->DispatcherQueue();
+            co_await ResumeOnPool{ TaskPriority::Interactive };
             SoftwareBitmap sb = SoftwareBitmap::CreateCopyFromBuffer(
                 buffer,
                 BitmapPixelFormat::Bgra8,
-                rtb.PixelWidth(),
-                rtb.PixelHeight(),
+                width,
+                height,
                 BitmapAlphaMode::Premultiplied);
+            readback.End();
+            co_await winrt::resume_foreground(dq);
 
             co_return sb;
         }
@@ -457,17 +781,9 @@ namespace winrt::PassportTool::implementation
         if (!bmp) co_return nullptr;
         try
         {
-            InMemoryRandomAccessStream stream;
-            auto enc = co_await BitmapEncoder::CreateAsync(BitmapEncoder::PngEncoderId(), stream);
-            enc.SetSoftwareBitmap(bmp);
-            enc.BitmapTransform().Rotation(BitmapRotation::Clockwise90Degrees);
-            co_await enc.FlushAsync();
-            stream.Seek(0);
-            auto dec = co_await BitmapDecoder::CreateAsync(stream);
-            auto rotated = co_await dec.GetSoftwareBitmapAsync();
-            if (rotated.BitmapPixelFormat() != BitmapPixelFormat::Bgra8 ||
-                rotated.BitmapAlphaMode() != BitmapAlphaMode::Premultiplied)
-                rotated = SoftwareBitmap::Convert(rotated, BitmapPixelFormat::Bgra8, BitmapAlphaMode::Premultiplied);
+            // Direct pixel transpose; no PNG encode/decode round trip.
+            TraceSpan span("rotate");
+            auto rotated = FromPixelBuffer(::PassportTool::Core::Rotate90(ToPixelBuffer(bmp)));
             co_return rotated;
         }
         catch (hresult_error const& ex) {
@@ -481,29 +797,49 @@ namespace winrt::PassportTool::implementation
         // Rotates the SOURCE image 90 degrees (permanent file-level rotation)
         if (!m_originalBitmap) co_return;
         auto strong = get_strong();
+        auto dq = this->DispatcherQueue();
+        auto source = m_originalBitmap;
 
+        // One turn at a time: a second click would rotate the same source
+        // and its result would be dropped, leaving m_quarterTurns behind.
+        auto btn = BtnRotate();
+        btn.IsEnabled(false);
         try
         {
-            auto rotated = co_await RotateBitmap90(m_originalBitmap);
-            if (!rotated) co_return;
-
-            m_originalBitmap = rotated;
-            SoftwareBitmapSource src;
-            co_await src.SetBitmapAsync(m_originalBitmap);
-            if (SourceImageControl()) SourceImageControl().Source(src);
-
-            // Reset visual rotation
-            if (auto s = RotationSlider()) s.Value(0);
-
-            ZoomToFit();
-
-            m_croppedStamp = nullptr;
-            m_croppedStampRotated = nullptr;
-            co_await RegeneratePreviewGrid();
+            co_await ResumeOnPool{ TaskPriority::Interactive };
+            auto rotated = co_await RotateBitmap90(source);
+            co_await winrt::resume_foreground(dq);
+            if (!rotated)
+            {
+                Log(L"Rotation failed");
+            }
+            else if (source == m_originalBitmap)    // else a new image was loaded meanwhile
+            {
+                m_originalBitmap = rotated;
+                m_quarterTurns = (m_quarterTurns + 1) % 4;
+                m_analysisLevel = nullptr;
+                CacheSource(rotated, m_sourceKey, m_quarterTurns);
+                SoftwareBitmapSource src;
+                co_await src.SetBitmapAsync(m_originalBitmap);
+                if (SourceImageControl()) SourceImageControl().Source(src);
+
+                // Reset visual rotation
+                if (auto s = RotationSlider()) s.Value(0);
+
+                ZoomToFit();
+
+                m_capturedStamp = nullptr;
+                m_croppedStamp = nullptr;
+                m_croppedStampRotated = nullptr;
+                m_stampKey = 0;
+                co_await RegeneratePreviewGrid();
+            }
         }
         catch (hresult_error const& ex) {
             Log(L"Rotation exception: " + ex.message());
         }
+        co_await winrt::resume_foreground(dq);
+        btn.IsEnabled(true);
     }
 
     // ──────────────────────────────────────────────────────────────
@@ -538,6 +874,82 @@ namespace winrt::PassportTool::implementation
         catch (hresult_error const&) {}
     }
 
+    // ──────────────────────────────────────────────────────────────
+    // Auto framing
+    // ──────────────────────────────────────────────────────────────
+
+    winrt::fire_and_forget MainWindow::AutoFrame()
+    {
+        auto strong = get_strong();
+        auto bmp = m_originalBitmap;
+        auto dq = this->DispatcherQueue();
+        if (!bmp || !dq) co_return;
+        auto spec = m_photoSpec;
+        auto level = m_analysisLevel;
+
+        try
+        {
+            // Detection and straightening only read the pixels; keep them off the UI thread.
+            co_await ResumeOnPool{ TaskPriority::Interactive };
+            TraceSpan detect("autoframe.detect");
+            int srcW = bmp.PixelWidth(), srcH = bmp.PixelHeight();
+            // A cached pyramid level saves copying the full-size source; the
+            // detectors reduce to a few hundred pixels either way.
+            ::PassportTool::Core::PixelBuffer full;
+            if (!level) full = ToPixelBuffer(bmp);
+            const auto& pixels = level ? *level : full;
+            auto face = ::PassportTool::Core::DetectFace(pixels);
+            auto scene = ::PassportTool::Core::EstimateTilt(pixels);
+            face = ::PassportTool::Core::ScaleDetection(face, static_cast<double>(srcW) / pixels.width);
+            face.tiltDeg = ::PassportTool::Core::CombineTilt(face, scene);
+            detect.End();
+
+            co_await winrt::resume_foreground(dq);
+            if (bmp != m_originalBitmap) co_return;   // superseded by a newer load/rotate
+
+            auto scroller = CropScrollViewer();
+            if (!scroller) co_return;
+
+            Log(L"AutoFrame: face " + to_hstring(face.confidence) +
+                L", scene tilt " + to_hstring(scene.angleDeg) + L" @ " + to_hstring(scene.confidence));
+
+            if (!face.found)
+            {
+                // No face to frame, but a confident scene tilt still straightens the shot.
+                if (scene.confidence > 0.3)
+                    if (auto s = RotationSlider()) s.Value(std::clamp(-scene.angleDeg, -20.0, 20.0));
+                co_return;
+            }
+
+            double vpW = scroller.ViewportWidth();
+            double vpH = scroller.ViewportHeight();
+            if (vpW <= 0 || vpH <= 0) co_return;
+
+            auto p = ::PassportTool::Core::ProposeCrop(face, spec, srcW, srcH, vpW, vpH);
+
+            if (auto s = RotationSlider()) s.Value(p.angleDeg);
+            scroller.ChangeView(p.offsetX, p.offsetY, static_cast<float>(p.zoom), true);
+        }
+        catch (hresult_error const& ex) {
+            Log(L"AutoFrame failed: " + ex.message());
+        }
+    }
+
+    void MainWindow::BtnAutoFrame_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        AutoFrame();
+    }
+
+    void MainWindow::OnPhotoSpecChanged(IInspectable const&, SelectionChangedEventArgs const&)
+    {
+        auto cb = CbPhotoSpec();
+        if (!cb) return;
+        m_photoSpec = (cb.SelectedIndex() == 1)
+            ? ::PassportTool::Core::kSpecIcao35x45
+            : ::PassportTool::Core::kSpecUs2x2;
+        if (m_isLoaded) AutoFrame();
+    }
+
     // ──────────────────────────────────────────────────────────────
     // Save sheet
     // ──────────────────────────────────────────────────────────────
@@ -554,54 +966,242 @@ namespace winrt::PassportTool::implementation
         auto windowNative{ this->try_as<::IWindowNative>() };
         windowNative->get_WindowHandle(&hwnd);
         initWnd->Initialize(hwnd);
-        picker.FileTypeChoices().Insert(L"JPEG", single_threaded_vector<hstring>({ L".jpg" }));
-        picker.FileTypeChoices().Insert(L"PNG", single_threaded_vector<hstring>({ L".png" }));
+        // A roll has no fixed size to encode as one image; it is raster only.
+        if (!IsRollMode())
+        {
+            picker.FileTypeChoices().Insert(L"JPEG", single_threaded_vector<hstring>({ L".jpg" }));
+            picker.FileTypeChoices().Insert(L"PNG", single_threaded_vector<hstring>({ L".png" }));
+        }
+        picker.FileTypeChoices().Insert(L"PWG Raster", single_threaded_vector<hstring>({ L".pwg" }));
+        picker.FileTypeChoices().Insert(L"Apple Raster", single_threaded_vector<hstring>({ L".urf" }));
         picker.SuggestedFileName(L"PassportSheet");
 
         StorageFile file = co_await picker.PickSaveFileAsync();
         if (!file) co_return;
 
-        try
+        if (file.FileType() == L".pwg" || file.FileType() == L".urf")
         {
-            SetOutlinesVisible(false);
+            // Printer-ready raster is streamed band by band straight into the
+            // file, so it has no size limit and no intermediate image.
+            auto format = file.FileType() == L".urf"
+                ? ::PassportTool::Core::RasterFormat::Urf : ::PassportTool::Core::RasterFormat::Pwg;
+            std::filesystem::path path(file.Path().c_str());
+            bool ok = co_await StreamRasterSheet(format, [path]() -> std::unique_ptr<::PassportTool::Core::ByteSink> {
+                auto sink = std::make_unique<::PassportTool::Core::FileSink>(path);
+                if (!sink->Ok()) return nullptr;
+                return sink;
+                });
+            if (!ok) Log(L"Save failed: could not write " + file.Path());
+            co_return;
+        }
 
+        // Composition and encoding run on the pool; only the oversized
+        // fallback needs the UI thread, for the XAML render.
+        auto dq = this->DispatcherQueue();
+        auto profile = m_printerProfile;
+        bool outlinesHidden = false;
+        try
+        {
+            TraceSpan span("save");
             int targetW = static_cast<int>(grid.Width());
             int targetH = static_cast<int>(grid.Height());
 
             constexpr int kMaxDim = 16384;
-            double scale = 1.0;
-            if (targetW > kMaxDim || targetH > kMaxDim) {
-                scale = std::min(static_cast<double>(kMaxDim) / targetW,
+            SoftwareBitmap sb{ nullptr };
+            if (targetW <= kMaxDim && targetH <= kMaxDim)
+            {
+                // Placements are whole pixels and the stamp was captured at the
+                // cell size, so the sheet is assembled from row copies with no
+                // resampling (and without the preview outlines).
+                auto stamp = m_croppedStamp;
+                auto rotated = m_croppedStampRotated;
+                auto placements = m_currentPlacements;
+                co_await ResumeOnPool{ TaskPriority::Normal };
+                TraceSpan compose("save.compose");
+                auto sheet = ::PassportTool::Core::ComposeSheet(targetW, targetH, placements,
+                    ToPixelBuffer(stamp), rotated ? ToPixelBuffer(rotated) : ::PassportTool::Core::PixelBuffer{});
+                sb = FromPixelBuffer(sheet);
+                compose.End();
+            }
+            else
+            {
+                // Beyond the encoder limit: let XAML render a scaled copy.
+                SetOutlinesVisible(false);
+                outlinesHidden = true;
+                double scale = std::min(static_cast<double>(kMaxDim) / targetW,
                     static_cast<double>(kMaxDim) / targetH);
                 targetW = static_cast<int>(targetW * scale);
                 targetH = static_cast<int>(targetH * scale);
-            }
 
-            RenderTargetBitmap rtb;
-            co_await rtb.RenderAsync(grid, targetW, targetH);
-
-            SoftwareBitmap sb(BitmapPixelFormat::Bgra8,
-                rtb.PixelWidth(), rtb.PixelHeight(),
-                BitmapAlphaMode::Premultiplied);
-            auto buffer = co_await rtb.GetPixelsAsync();
-            sb.CopyFromBuffer(buffer);
-
-            SetOutlinesVisible(true);
+                TraceSpan render("save.render");
+                RenderTargetBitmap rtb;
+                co_await rtb.RenderAsync(grid, targetW, targetH);
+                render.End();
+
+                TraceSpan readback("save.get_pixels");
+                sb = SoftwareBitmap(BitmapPixelFormat::Bgra8,
+                    rtb.PixelWidth(), rtb.PixelHeight(),
+                    BitmapAlphaMode::Premultiplied);
+                auto buffer = co_await rtb.GetPixelsAsync();
+                sb.CopyFromBuffer(buffer);
+                readback.End();
+
+                SetOutlinesVisible(true);
+                outlinesHidden = false;
+                co_await ResumeOnPool{ TaskPriority::Normal };
+            }
 
             auto ext = file.FileType();
             auto encoderId = (ext == L".png") ? BitmapEncoder::PngEncoderId()
                 : BitmapEncoder::JpegEncoderId();
 
-            auto stream = co_await file.OpenAsync(FileAccessMode::ReadWrite);
-            auto enc = co_await BitmapEncoder::CreateAsync(encoderId, stream);
-            enc.SetSoftwareBitmap(sb);
-            enc.BitmapTransform().InterpolationMode(BitmapInterpolationMode::Fant);
-            co_await enc.FlushAsync();
+            if (!profile)
+            {
+                TraceSpan encode("save.encode");
+                auto stream = co_await file.OpenAsync(FileAccessMode::ReadWrite);
+                auto enc = co_await BitmapEncoder::CreateAsync(encoderId, stream);
+                enc.SetSoftwareBitmap(sb);
+                enc.BitmapTransform().InterpolationMode(BitmapInterpolationMode::Fant);
+                co_await enc.FlushAsync();
+            }
+            else
+            {
+                // The WinRT encoder cannot attach a colour profile, so encode
+                // to memory and splice the printer profile into the byte stream.
+                TraceSpan encode("save.encode");
+                InMemoryRandomAccessStream mem;
+                auto enc = co_await BitmapEncoder::CreateAsync(encoderId, mem);
+                enc.SetSoftwareBitmap(sb);
+                enc.BitmapTransform().InterpolationMode(BitmapInterpolationMode::Fant);
+                co_await enc.FlushAsync();
+
+                std::vector<uint8_t> bytes(static_cast<size_t>(mem.Size()));
+                DataReader reader(mem.GetInputStreamAt(0));
+                co_await reader.LoadAsync(static_cast<uint32_t>(bytes.size()));
+                reader.ReadBytes(bytes);
+                encode.End();
+                co_await ResumeOnPool{ TaskPriority::Normal };
+
+                TraceSpan embed("save.embed_icc");
+                bool embedded = (ext == L".png")
+                    ? ::PassportTool::Core::EmbedIccInPng(bytes, *profile)
+                    : ::PassportTool::Core::EmbedIccInJpeg(bytes, *profile);
+                embed.End();
+                if (!embedded) Log(L"Save: could not embed printer profile");
+
+                TraceSpan write("save.write");
+                co_await FileIO::WriteBytesAsync(file, bytes);
+            }
         }
         catch (hresult_error const& ex) {
-            SetOutlinesVisible(true);
             Log(L"Save failed: " + ex.message());
         }
+        if (outlinesHidden)
+        {
+            co_await winrt::resume_foreground(dq);
+            SetOutlinesVisible(true);
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Direct-to-printer raster
+    // ──────────────────────────────────────────────────────────────
+
+    winrt::Windows::Foundation::IAsyncOperation<bool> MainWindow::StreamRasterSheet(::PassportTool::Core::RasterFormat format,
+        std::function<std::unique_ptr<::PassportTool::Core::ByteSink>()> openSink)
+    {
+        auto grid = PreviewGrid();
+        if (!grid || m_currentPlacements.empty() || !m_croppedStamp) co_return false;
+        auto strong = get_strong();
+
+        // Only placements and sheet size are needed to compose bands.
+        ::PassportTool::Core::LayoutResult layout;
+        layout.placements = m_currentPlacements;
+        layout.metrics.sheetW = static_cast<int>(grid.Width());
+        layout.metrics.sheetH = static_cast<int>(grid.Height());
+        int dpi = static_cast<int>(std::lround(GetOutputDpi()));
+        auto stamp = m_croppedStamp;
+        auto rotated = m_croppedStampRotated;
+        // The header must describe the pixels as committed, not the current
+        // profile setting.
+        auto color = m_croppedStampColor;
+        // A roll streams every stamp, not just the previewed ones.
+        std::optional<::PassportTool::Core::RollLayout> roll;
+        if (m_rollCount > 0) roll = m_roll;
+        uint64_t rollCount = m_rollCount;
+
+        co_await ResumeOnPool{ TaskPriority::Normal };
+        auto sink = openSink();
+        if (!sink) co_return false;
+        auto rotatedPixels = rotated ? ToPixelBuffer(rotated) : ::PassportTool::Core::PixelBuffer{};
+        if (roll)
+            co_return ::PassportTool::Core::StreamRoll(*roll, rollCount, ToPixelBuffer(stamp), rotatedPixels, format, color, dpi, *sink);
+        co_return ::PassportTool::Core::StreamSheet(layout, ToPixelBuffer(stamp), rotatedPixels, format, color, dpi, *sink);
+    }
+
+    winrt::fire_and_forget MainWindow::BtnSendToPrinter_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        auto strong = get_strong();
+        std::string host;
+        uint16_t port = 0;
+        if (!::PassportTool::Core::ParseHostPort(winrt::to_string(TxtPrinterAddress().Text()), &host, &port))
+        {
+            Log(L"Send: printer address must be host or host:port");
+            co_return;
+        }
+        auto format = CbRasterFormat().SelectedIndex() == 1
+            ? ::PassportTool::Core::RasterFormat::Urf : ::PassportTool::Core::RasterFormat::Pwg;
+
+        auto btn = BtnSendToPrinter();
+        btn.IsEnabled(false);
+        auto dq = this->DispatcherQueue();
+        try
+        {
+            bool ok = co_await StreamRasterSheet(format, [this, host, port]() -> std::unique_ptr<::PassportTool::Core::ByteSink> {
+                std::string error;
+                auto sink = ::PassportTool::Core::SocketSink::Connect(host, port, &error);
+                if (!sink) Log(L"Send: " + winrt::to_hstring(error));
+                return sink;
+                });
+            if (!ok) Log(L"Send failed");
+        }
+        catch (hresult_error const& ex) {
+            Log(L"Send failed: " + ex.message());
+        }
+        co_await winrt::resume_foreground(dq);
+        btn.IsEnabled(true);
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Performance trace
+    // ──────────────────────────────────────────────────────────────
+
+    winrt::fire_and_forget MainWindow::BtnExportTrace_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        auto strong = get_strong();
+        FileSavePicker picker;
+        auto initWnd{ picker.as<::IInitializeWithWindow>() };
+        HWND hwnd;
+        auto windowNative{ this->try_as<::IWindowNative>() };
+        windowNative->get_WindowHandle(&hwnd);
+        initWnd->Initialize(hwnd);
+        picker.FileTypeChoices().Insert(L"Chrome trace", single_threaded_vector<hstring>({ L".json" }));
+        picker.SuggestedFileName(L"PassportTool-trace");
+
+        StorageFile file = co_await picker.PickSaveFileAsync();
+        if (!file) co_return;
+
+        try
+        {
+            Log(to_hstring(::PassportTool::Core::FormatTraceSummary()));
+            auto json = ::PassportTool::Core::ExportChromeTrace();
+            co_await FileIO::WriteBytesAsync(file, winrt::array_view<uint8_t const>(
+                reinterpret_cast<uint8_t const*>(json.data()),
+                reinterpret_cast<uint8_t const*>(json.data()) + json.size()));
+        }
+        catch (hresult_error const& ex) {
+            Log(L"Trace export failed: " + ex.message());
+        }
     }
 
     // ──────────────────────────────────────────────────────────────
@@ -627,35 +1227,409 @@ namespace winrt::PassportTool::implementation
         auto strong = get_strong();
         try
         {
-            auto stream = co_await file.OpenAsync(FileAccessMode::Read);
-            auto decoder = co_await BitmapDecoder::CreateAsync(stream);
-            m_originalBitmap = co_await decoder.GetSoftwareBitmapAsync();
+            if (!co_await LoadSource(file, 0, 0)) co_return;
 
-            if (m_originalBitmap.BitmapPixelFormat() != BitmapPixelFormat::Bgra8 ||
-                m_originalBitmap.BitmapAlphaMode() != BitmapAlphaMode::Premultiplied)
-                m_originalBitmap = SoftwareBitmap::Convert(
-                    m_originalBitmap, BitmapPixelFormat::Bgra8, BitmapAlphaMode::Premultiplied);
+            auto weak = get_weak();
+            if (auto dq = this->DispatcherQueue())
+                dq.TryEnqueue([weak]() {
+                    if (auto s = weak.get()) { s->ZoomToFit(); s->AutoFrame(); }
+                    });
+        }
+        catch (hresult_error const& ex) {
+            Log(L"LoadImageFromFile failed: " + ex.message());
+        }
+    }
 
-            SoftwareBitmapSource src;
-            co_await src.SetBitmapAsync(m_originalBitmap);
-            if (SourceImageControl())
+    // Makes `file`, turned quarterTurns times, the source image. With a known
+    // content key the pixels come straight from the cache without touching
+    // the file; otherwise the file is read once, hashed, and decoded only if
+    // the cache has not seen it before.
+    winrt::Windows::Foundation::IAsyncOperation<bool> MainWindow::LoadSource(StorageFile file, uint64_t knownKey, int quarterTurns)
+    {
+        auto strong = get_strong();
+        auto dq = this->DispatcherQueue();
+        auto cache = Cache();
+        if (!dq) co_return false;
+        TraceSpan span("load");
+
+        IBuffer bytes{ nullptr };
+        if (!knownKey)
+        {
+            if (!file) co_return false;
+            TraceSpan read("load.read");
+            bytes = co_await FileIO::ReadBufferAsync(file);
+        }
+
+        uint64_t key = knownKey;
+        SoftwareBitmap bmp{ nullptr };
+        std::shared_ptr<const ::PassportTool::Core::PixelBuffer> analysis;
+
+        // Hash, cache lookup, decode, conversion and turns all run on the
+        // pool; the UI thread only takes the finished bitmap.
+        co_await ResumeOnPool{ TaskPriority::Interactive };
+        if (bytes)
+        {
+            TraceSpan hash("load.hash");
+            key = ::PassportTool::Core::HashBytes(bytes.data(), bytes.Length());
+        }
+        if (cache)
+        {
+            if (auto hit = cache->Find(SourceLevelKey(key, quarterTurns, 0)))
+            {
+                TraceSpan cached("load.cache_hit");
+                bmp = FromMapped(*hit);
+                analysis = FindAnalysisLevel(*cache, key, quarterTurns);
+            }
+        }
+
+        bool fromCache = static_cast<bool>(bmp);
+        if (!bmp)
+        {
+            // Evicted since the project was saved: go back to the file.
+            if (!bytes)
+            {
+                co_await winrt::resume_foreground(dq);
+                co_return co_await LoadSource(file, 0, quarterTurns);
+            }
+
+            TraceSpan decode("load.decode");
+            InMemoryRandomAccessStream mem;
+            co_await mem.WriteAsync(bytes);
+            mem.Seek(0);
+            auto decoder = co_await BitmapDecoder::CreateAsync(mem);
+            bmp = co_await decoder.GetSoftwareBitmapAsync();
+            decode.End();
+            // WinRT async calls complete on the system thread pool; the
+            // conversion and turns belong back on ours.
+            co_await ResumeOnPool{ TaskPriority::Interactive };
+
+            if (bmp.BitmapPixelFormat() != BitmapPixelFormat::Bgra8 ||
+                bmp.BitmapAlphaMode() != BitmapAlphaMode::Premultiplied)
+            {
+                TraceSpan convert("load.convert");
+                bmp = SoftwareBitmap::Convert(bmp, BitmapPixelFormat::Bgra8, BitmapAlphaMode::Premultiplied);
+            }
+            for (int i = 0; i < quarterTurns && bmp; ++i)
+                bmp = co_await RotateBitmap90(bmp);
+        }
+        co_await winrt::resume_foreground(dq);
+        if (!bmp) co_return false;
+
+        m_originalBitmap = bmp;
+        TraceSpan display("load.display");
+        SoftwareBitmapSource src;
+        co_await src.SetBitmapAsync(m_originalBitmap);
+        if (SourceImageControl())
+        {
+            SourceImageControl().Source(src);
+            if (auto t = ImageRotateTransform()) t.Angle(0);
+        }
+        if (RotationSlider()) RotationSlider().Value(0);
+        display.End();
+
+        m_sourceFile = file;
+        m_sourceKey = key;
+        m_quarterTurns = quarterTurns;
+        m_analysisLevel = analysis;
+        m_capturedStamp = nullptr;
+        m_croppedStamp = nullptr;
+        m_croppedStampRotated = nullptr;
+        m_stampKey = 0;
+
+        if (!fromCache) CacheSource(bmp, key, quarterTurns);
+        co_await RegeneratePreviewGrid();
+        co_return true;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Pixel cache
+    // ──────────────────────────────────────────────────────────────
+
+    std::shared_ptr<::PassportTool::Core::PixelCache> MainWindow::Cache()
+    {
+        if (!m_cache)
+        {
+            try
+            {
+                std::filesystem::path dir(std::wstring(ApplicationData::Current().LocalCacheFolder().Path()));
+                m_cache = std::make_shared<::PassportTool::Core::PixelCache>(dir / L"pixels", kCacheCapacity);
+            }
+            catch (hresult_error const& ex) {
+                Log(L"Pixel cache unavailable: " + ex.message());
+            }
+        }
+        return m_cache;
+    }
+
+    // Stores the decoded source and its pyramid so the next open of the same
+    // file (or of a saved job) skips decoding.
+    winrt::fire_and_forget MainWindow::CacheSource(SoftwareBitmap bmp, uint64_t sourceKey, int quarterTurns)
+    {
+        auto strong = get_strong();
+        auto cache = Cache();
+        auto dq = this->DispatcherQueue();
+        if (!cache || !bmp || !sourceKey || !dq) co_return;
+
+        try
+        {
+            co_await ResumeOnPool{ TaskPriority::Background };
+            TraceSpan span("cache.source");
+            auto pixels = ToPixelBuffer(bmp);
+            cache->Store(SourceLevelKey(sourceKey, quarterTurns, 0), pixels);
+
+            auto levels = ::PassportTool::Core::BuildPyramid(pixels, kPyramidMinDim);
+            int analysisIndex = -1;
+            for (size_t i = 0; i < levels.size(); ++i)
             {
-                SourceImageControl().Source(src);
-                if (auto t = ImageRotateTransform()) t.Angle(0);
+                cache->Store(SourceLevelKey(sourceKey, quarterTurns, static_cast<int>(i) + 1), levels[i]);
+                if (std::max(levels[i].width, levels[i].height) >= kAnalysisMinDim)
+                    analysisIndex = static_cast<int>(i);
             }
-            if (RotationSlider()) RotationSlider().Value(0);
+            std::shared_ptr<const ::PassportTool::Core::PixelBuffer> analysis;
+            if (analysisIndex >= 0)
+                analysis = std::make_shared<const ::PassportTool::Core::PixelBuffer>(std::move(levels[analysisIndex]));
+            span.End();
 
-            m_croppedStamp = nullptr;
-            m_croppedStampRotated = nullptr;
+            co_await winrt::resume_foreground(dq);
+            if (bmp == m_originalBitmap && !m_analysisLevel) m_analysisLevel = analysis;
+        }
+        catch (hresult_error const& ex) {
+            Log(L"Caching source failed: " + ex.message());
+        }
+    }
 
-            co_await RegeneratePreviewGrid();
+    winrt::fire_and_forget MainWindow::CacheStamp(SoftwareBitmap stamp, uint64_t key)
+    {
+        auto strong = get_strong();
+        auto cache = Cache();
+        if (!cache || !stamp || !key) co_return;
 
+        try
+        {
+            co_await ResumeOnPool{ TaskPriority::Background };
+            TraceSpan span("cache.stamp");
+            cache->Store(key, ToPixelBuffer(stamp));
+        }
+        catch (hresult_error const& ex) {
+            Log(L"Caching stamp failed: " + ex.message());
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Project (job) files
+    // ──────────────────────────────────────────────────────────────
+
+    ::PassportTool::Core::CropTransform MainWindow::CurrentCropTransform()
+    {
+        ::PassportTool::Core::CropTransform crop;
+        if (auto scroller = CropScrollViewer())
+        {
+            crop.zoom = scroller.ZoomFactor();
+            crop.offsetX = scroller.HorizontalOffset();
+            crop.offsetY = scroller.VerticalOffset();
+            crop.viewportW = scroller.ViewportWidth();
+            crop.viewportH = scroller.ViewportHeight();
+        }
+        if (auto s = RotationSlider()) crop.angleDeg = s.Value();
+        return crop;
+    }
+
+    // Re-applies a saved framing. The viewport may be a different size now
+    // (window size), so the zoom is scaled to show the same image region
+    // around the same centre.
+    void MainWindow::RestoreCropView(::PassportTool::Core::CropTransform const& saved)
+    {
+        auto scroller = CropScrollViewer();
+        if (!scroller || saved.zoom <= 0) return;
+        if (auto s = RotationSlider()) s.Value(std::clamp(saved.angleDeg, -20.0, 20.0));
+
+        double vpW = scroller.ViewportWidth();
+        double vpH = scroller.ViewportHeight();
+        double zoom = saved.zoom;
+        if (vpW > 0 && saved.viewportW > 0) zoom *= vpW / saved.viewportW;
+        zoom = std::clamp(zoom, 0.1, 10.0);
+
+        double cx = (saved.offsetX + saved.viewportW * 0.5) / saved.zoom;
+        double cy = (saved.offsetY + saved.viewportH * 0.5) / saved.zoom;
+        scroller.ChangeView(cx * zoom - vpW * 0.5, cy * zoom - vpH * 0.5, static_cast<float>(zoom), true);
+    }
+
+    winrt::fire_and_forget MainWindow::BtnSaveProject_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        if (!m_originalBitmap || !m_sourceKey) co_return;
+        auto strong = get_strong();
+
+        FileSavePicker picker;
+        auto initWnd{ picker.as<::IInitializeWithWindow>() };
+        HWND hwnd;
+        auto windowNative{ this->try_as<::IWindowNative>() };
+        windowNative->get_WindowHandle(&hwnd);
+        initWnd->Initialize(hwnd);
+        picker.FileTypeChoices().Insert(L"PassportTool job", single_threaded_vector<hstring>({ L".ptjob" }));
+        picker.SuggestedFileName(m_sourceFile ? m_sourceFile.DisplayName() : hstring(L"PassportJob"));
+
+        StorageFile file = co_await picker.PickSaveFileAsync();
+        if (!file) co_return;
+
+        try
+        {
+            ::PassportTool::Core::ProjectFile p;
+            auto access = StorageApplicationPermissions::FutureAccessList();
+            p.sourceHash = m_sourceKey;
+            p.quarterTurns = m_quarterTurns;
+            if (m_sourceFile)
+            {
+                // Deterministic tokens so re-saving a job does not grow the list.
+                p.sourcePath = to_string(m_sourceFile.Path());
+                p.sourceToken = "src-" + HexKey(m_sourceKey);
+                access.AddOrReplace(to_hstring(p.sourceToken), m_sourceFile);
+            }
+            p.crop = CurrentCropTransform();
+
+            p.metric = RadioCm() && RadioCm().IsChecked() && RadioCm().IsChecked().Value();
+            // A cleared NumberBox reads NaN, which ParseProject rejects and
+            // an int cast cannot hold; such fields keep the job defaults.
+            auto read = [](NumberBox const& box, double* out, double minimum) {
+                if (!box) return;
+                double v = box.Value();
+                if (std::isfinite(v) && v >= minimum) *out = v;
+                };
+            read(NbImageW(), &p.imageW, 1e-6);
+            read(NbImageH(), &p.imageH, 1e-6);
+            read(NbSheetW(), &p.sheetW, 1e-6);
+            read(NbSheetH(), &p.sheetH, 1e-6);
+            read(NbGap(), &p.gap, 0);
+            p.roll = IsRollMode();
+            double rollCount = p.rollCount;
+            read(NbRollCount(), &rollCount, 1);
+            if (NbRollCount()) rollCount = std::min(rollCount, NbRollCount().Maximum());
+            p.rollCount = static_cast<int>(rollCount);
+            p.dpi = GetOutputDpi();
+            p.photoSpec = CbPhotoSpec() ? std::max(0, CbPhotoSpec().SelectedIndex()) : 0;
+            p.whiteBackground = ChkWhiteBackground() && ChkWhiteBackground().IsChecked() &&
+                ChkWhiteBackground().IsChecked().Value();
+            p.printMedia = CbPrintMedia() ? std::max(0, CbPrintMedia().SelectedIndex()) : 0;
+            if (m_printerProfileFile && m_printerProfile)
+            {
+                p.printerProfilePath = to_string(m_printerProfileFile.Path());
+                p.printerProfileToken = "icc-" + HexKey(m_printerProfile->Hash());
+                access.AddOrReplace(to_hstring(p.printerProfileToken), m_printerProfileFile);
+            }
+            p.stampKey = m_capturedStamp ? m_stampKey : 0;
+
+            auto text = ::PassportTool::Core::SerializeProject(p);
+            co_await FileIO::WriteBytesAsync(file, winrt::array_view<uint8_t const>(
+                reinterpret_cast<uint8_t const*>(text.data()),
+                reinterpret_cast<uint8_t const*>(text.data()) + text.size()));
+        }
+        catch (hresult_error const& ex) {
+            Log(L"Save job failed: " + ex.message());
+        }
+    }
+
+    winrt::fire_and_forget MainWindow::BtnOpenProject_Click(IInspectable const&, RoutedEventArgs const&)
+    {
+        auto strong = get_strong();
+        FileOpenPicker picker;
+        auto initWnd{ picker.as<::IInitializeWithWindow>() };
+        HWND hwnd;
+        auto windowNative{ this->try_as<::IWindowNative>() };
+        windowNative->get_WindowHandle(&hwnd);
+        initWnd->Initialize(hwnd);
+        picker.FileTypeFilter().ReplaceAll({ L".ptjob" });
+        StorageFile file = co_await picker.PickSingleFileAsync();
+        if (file) co_await OpenProject(file);
+    }
+
+    winrt::Windows::Foundation::IAsyncAction MainWindow::OpenProject(StorageFile file)
+    {
+        auto strong = get_strong();
+        auto dq = this->DispatcherQueue();
+        if (!dq) co_return;
+        try
+        {
+            TraceSpan span("project.open");
+            auto buffer = co_await FileIO::ReadBufferAsync(file);
+            std::string text(reinterpret_cast<const char*>(buffer.data()), buffer.Length());
+            std::string error;
+            auto project = ::PassportTool::Core::ParseProject(text, &error);
+            if (!project)
+            {
+                Log(L"Open job failed: " + to_hstring(error));
+                co_return;
+            }
+            const auto p = *project;
+
+            // Settings first with the change handlers muted (they all bail out
+            // while !m_isLoaded), then one refresh.
+            m_capturedStamp = nullptr;
+            m_isLoaded = false;
+            if (RadioCm()) RadioCm().IsChecked(p.metric);
+            if (RadioInches()) RadioInches().IsChecked(!p.metric);
+            if (NbSheetW()) NbSheetW().Value(p.sheetW);
+            if (NbSheetH()) NbSheetH().Value(p.sheetH);
+            if (NbRollCount()) NbRollCount().Value(p.rollCount);
+            if (ChkRollMode()) ChkRollMode().IsChecked(p.roll);
+            UpdateRollModeUi();
+            if (NbGap()) NbGap().Value(p.gap);
+            if (NbDpi()) NbDpi().Value(p.dpi);
+            if (NbImageW()) NbImageW().Value(p.imageW);
+            if (NbImageH()) NbImageH().Value(p.imageH);
+            if (CbPhotoSpec()) CbPhotoSpec().SelectedIndex(std::clamp(p.photoSpec, 0, 1));
+            m_photoSpec = (p.photoSpec == 1) ? ::PassportTool::Core::kSpecIcao35x45 : ::PassportTool::Core::kSpecUs2x2;
+            if (ChkWhiteBackground()) ChkWhiteBackground().IsChecked(p.whiteBackground);
+            if (CbPrintMedia()) CbPrintMedia().SelectedIndex(std::clamp(p.printMedia, 0, 3));
+            m_isLoaded = true;
+            UpdateSheetSize();
+            RefitCropContainer();
+            UpdateCellDimensionsDisplay();
+
+            auto profile = co_await ResolveFile(p.printerProfileToken, p.printerProfilePath);
+            if (!profile && !p.printerProfilePath.empty())
+                Log(L"Open job: printer profile not found, using sRGB");
+            co_await ApplyPrinterProfile(profile);
+
+            auto source = co_await ResolveFile(p.sourceToken, p.sourcePath);
+            if (!co_await LoadSource(source, p.sourceHash, p.quarterTurns))
+            {
+                Log(L"Open job: source image is neither cached nor accessible");
+                co_return;
+            }
+
+            // The framing needs a layout pass with the new image in place.
             auto weak = get_weak();
-            if (auto dq = this->DispatcherQueue())
-                dq.TryEnqueue([weak]() { if (auto s = weak.get()) s->ZoomToFit(); });
+            auto crop = p.crop;
+            dq.TryEnqueue([weak, crop]() {
+                if (auto s = weak.get()) s->RestoreCropView(crop);
+                });
+
+            // A cached capture means no RenderTargetBitmap pass at all. If
+            // the source had to be re-read and its content changed, the
+            // cached stamp belongs to the old image and is not used.
+            bool sourceChanged = p.sourceHash && m_sourceKey != p.sourceHash;
+            if (sourceChanged)
+                Log(L"Open job: source image changed since the job was saved; recapture the stamp");
+            SoftwareBitmap stamp{ nullptr };
+            if (auto cache = Cache(); cache && p.stampKey && !sourceChanged)
+            {
+                co_await ResumeOnPool{ TaskPriority::Interactive };
+                if (auto hit = cache->Find(p.stampKey)) stamp = FromMapped(*hit);
+                co_await winrt::resume_foreground(dq);
+            }
+            if (stamp)
+            {
+                m_capturedStamp = stamp;
+                m_stampKey = p.stampKey;
+                co_await CommitStamp();
+            }
+            else if (p.stampKey && !sourceChanged)
+            {
+                Log(L"Open job: cached stamp evicted; use Update Sheet to recapture");
+            }
         }
         catch (hresult_error const& ex) {
-            Log(L"LoadImageFromFile failed: " + ex.message());
+            m_isLoaded = true;
+            Log(L"Open job failed: " + ex.message());
         }
     }
 
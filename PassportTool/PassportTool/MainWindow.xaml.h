@@ -7,17 +7,27 @@
 #include <winrt/Windows.ApplicationModel.DataTransfer.h>
 #include <winrt/Windows.Storage.h>
 #include <vector>
+#include "PixelBuffer.h"
+#include "Layout.h"
+#include "FaceDetector.h"
+#include "TiltEstimator.h"
+#include "BackgroundReplacer.h"
+#include "ColorManagement.h"
+#include "Sharpen.h"
+#include "Transform.h"
+#include "SheetCompositor.h"
+#include "Trace.h"
+#include "PixelCache.h"
+#include "Project.h"
+#include "Raster.h"
+#include "TaskScheduler.h"
+#include <functional>
+#include <memory>
+#include <optional>
 
 namespace winrt::PassportTool::implementation
 {
-    struct ImagePlacement
-    {
-        double x;       // left edge in pixels
-        double y;       // top edge in pixels
-        double w;       // width in pixels (on sheet)
-        double h;       // height in pixels (on sheet)
-        bool rotated;   // true = image content is rotated 90 degrees
-    };
+    using ImagePlacement = ::PassportTool::Core::ImagePlacement;
 
     struct MainWindow : MainWindowT<MainWindow>
     {
@@ -31,9 +41,20 @@ namespace winrt::PassportTool::implementation
         winrt::fire_and_forget BtnApplyCrop_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
         winrt::fire_and_forget BtnSaveSheet_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
         winrt::fire_and_forget BtnRotate_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        void BtnAutoFrame_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        winrt::fire_and_forget BtnPrinterProfile_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        winrt::fire_and_forget OnBackgroundOptionChanged(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        winrt::fire_and_forget OnPrintMediaChanged(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::Controls::SelectionChangedEventArgs const& e);
+        void OnPhotoSpecChanged(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::Controls::SelectionChangedEventArgs const& e);
+        winrt::fire_and_forget BtnOpenProject_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        winrt::fire_and_forget BtnSaveProject_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        winrt::fire_and_forget BtnExportTrace_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        winrt::fire_and_forget BtnSendToPrinter_Click(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
+        void OnRollModeChanged(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
 
         void OnUnitChanged(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::RoutedEventArgs const& e);
         void OnSettingsChanged(winrt::Microsoft::UI::Xaml::Controls::NumberBox const& sender, winrt::Microsoft::UI::Xaml::Controls::NumberBoxValueChangedEventArgs const& args);
+        winrt::fire_and_forget OnDpiChanged(winrt::Microsoft::UI::Xaml::Controls::NumberBox const& sender, winrt::Microsoft::UI::Xaml::Controls::NumberBoxValueChangedEventArgs const& args);
 
         // Rotation
         void OnRotationChanged(winrt::Windows::Foundation::IInspectable const& sender, winrt::Microsoft::UI::Xaml::Controls::Primitives::RangeBaseValueChangedEventArgs const& e);
@@ -54,35 +75,88 @@ namespace winrt::PassportTool::implementation
         void UpdateSheetSize();
         void RefitCropContainer();
         void UpdateCellDimensionsDisplay();
+        double GetOutputDpi();
         double GetPixelsPerUnit();
+        bool IsRollMode();
+        void UpdateRollModeUi();
         void Log(winrt::hstring const& message);
 
         // Placement algorithm
         std::vector<ImagePlacement> CalculateOptimalPlacement(
             double sheetW, double sheetH, double imgW, double imgH, double gap);
+        // Roll mode: searches the repeating unit into m_roll and returns the
+        // first stamps for the preview.
+        std::vector<ImagePlacement> CalculateRollPlacement(
+            double rollW, double imgW, double imgH, double gap, uint64_t count);
 
         // Preview outline control
         void SetOutlinesVisible(bool visible);
 
         // High-res processing
         winrt::Windows::Foundation::IAsyncAction LoadImageFromFile(winrt::Windows::Storage::StorageFile file);
+        winrt::Windows::Foundation::IAsyncOperation<bool> LoadSource(winrt::Windows::Storage::StorageFile file, uint64_t knownKey, int quarterTurns);
+        winrt::Windows::Foundation::IAsyncAction ApplyPrinterProfile(winrt::Windows::Storage::StorageFile file);
+
+        // Project files + pixel cache
+        winrt::Windows::Foundation::IAsyncAction OpenProject(winrt::Windows::Storage::StorageFile file);
+        std::shared_ptr<::PassportTool::Core::PixelCache> Cache();
+        winrt::fire_and_forget CacheSource(winrt::Windows::Graphics::Imaging::SoftwareBitmap bmp, uint64_t sourceKey, int quarterTurns);
+        winrt::fire_and_forget CacheStamp(winrt::Windows::Graphics::Imaging::SoftwareBitmap stamp, uint64_t key);
+        ::PassportTool::Core::CropTransform CurrentCropTransform();
+        void RestoreCropView(::PassportTool::Core::CropTransform const& saved);
 
         // UPDATED: Now returns a render capture of the viewport
         winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Graphics::Imaging::SoftwareBitmap> CaptureCropAsBitmap();
 
+        winrt::Windows::Foundation::IAsyncAction CaptureStamp();
+        winrt::Windows::Foundation::IAsyncAction CommitStamp();
+
+        // Direct-to-printer raster; openSink runs on the background thread.
+        winrt::Windows::Foundation::IAsyncOperation<bool> StreamRasterSheet(::PassportTool::Core::RasterFormat format,
+            std::function<std::unique_ptr<::PassportTool::Core::ByteSink>()> openSink);
+
         winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Graphics::Imaging::SoftwareBitmap> RotateBitmap90(winrt::Windows::Graphics::Imaging::SoftwareBitmap bmp);
         void ZoomToFit();
 
+        // Face + scene-tilt framing: pans/zooms/rotates the crop viewport to the spec
+        winrt::fire_and_forget AutoFrame();
+
         // State
         bool m_isLoaded{ false };
         winrt::Windows::Graphics::Imaging::SoftwareBitmap m_originalBitmap{ nullptr };
+        winrt::Windows::Graphics::Imaging::SoftwareBitmap m_capturedStamp{ nullptr };   // raw viewport capture
         winrt::Windows::Graphics::Imaging::SoftwareBitmap m_croppedStamp{ nullptr };
         winrt::Windows::Graphics::Imaging::SoftwareBitmap m_croppedStampRotated{ nullptr };
+        // Device RGB once the printer profile has been applied to the stamp.
+        ::PassportTool::Core::RasterColor m_croppedStampColor{ ::PassportTool::Core::RasterColor::Srgb };
+        uint64_t m_commitGeneration{ 0 };   // bumped per CommitStamp; only the latest publishes
 
         bool m_isDragging{ false };
         bool m_zoomingFromMouse{ false };
         winrt::Windows::Foundation::Point m_lastPoint{ 0,0 };
 
+        ::PassportTool::Core::PassportSpec m_photoSpec{ ::PassportTool::Core::kSpecUs2x2 };
+
+        // Printer colour management (sRGB stamp -> printer profile)
+        std::optional<::PassportTool::Core::IccProfile> m_printerProfile;
+        std::shared_ptr<const ::PassportTool::Core::ColorTransform> m_printTransform;
+
+        // Job identity: content hash of the source file, quarter turns applied
+        // with Rotate 90° and the cache key of the last capture.
+        winrt::Windows::Storage::StorageFile m_sourceFile{ nullptr };
+        winrt::Windows::Storage::StorageFile m_printerProfileFile{ nullptr };
+        uint64_t m_sourceKey{ 0 };
+        int m_quarterTurns{ 0 };
+        uint64_t m_stampKey{ 0 };
+
+        // Roll mode: the full job is m_rollCount stamps of m_roll; the
+        // preview (m_currentPlacements) shows only the start of it.
+        ::PassportTool::Core::RollLayout m_roll;
+        uint64_t m_rollCount{ 0 };
+        std::shared_ptr<::PassportTool::Core::PixelCache> m_cache;
+        // Pyramid level used for detection (~1-2k px), if already available.
+        std::shared_ptr<const ::PassportTool::Core::PixelBuffer> m_analysisLevel;
+
         std::vector<ImagePlacement> m_currentPlacements;
         std::vector<winrt::Microsoft::UI::Xaml::Controls::Border> m_outlineBorders;
     };
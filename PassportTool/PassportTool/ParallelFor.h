@@ -0,0 +1,34 @@
+#pragma once
+
+// Minimal fork/join helper for the row- and tile-parallel image stages.
+
+#include "TaskScheduler.h"
+#include <algorithm>
+
+namespace PassportTool::Core
+{
+    // Splits [0, count) into contiguous bands of at least minPerTask items
+    // and runs fn(begin, end) on the shared TaskScheduler (the calling thread
+    // takes the first band). Bands inherit the caller's task priority, so a
+    // background stage yields to interactive work between bands. Small
+    // ranges run inline.
+    template <typename Fn>
+    void ParallelFor(int count, int minPerTask, Fn&& fn)
+    {
+        if (count <= 0) return;
+        auto& pool = TaskScheduler::Shared();
+        int workers = static_cast<int>(std::max(1u, pool.WorkerCount()));
+        int tasks = std::clamp(count / std::max(1, minPerTask), 1, workers);
+        if (tasks == 1)
+        {
+            fn(0, count);
+            return;
+        }
+
+        int per = (count + tasks - 1) / tasks;
+        tasks = (count + per - 1) / per;
+        pool.ForEach(tasks, CurrentTaskPriority(), [&fn, per, count](int t) {
+            fn(t * per, std::min(count, (t + 1) * per));
+            });
+    }
+}
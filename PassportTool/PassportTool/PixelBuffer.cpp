@@ -0,0 +1,114 @@
+#include "PixelBuffer.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PT_HAVE_SSE2 1
+#endif
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        int ReductionFactor(int w, int h, int maxDim)
+        {
+            int longest = std::max(w, h);
+            if (maxDim <= 0 || longest <= maxDim) return 1;
+            return (longest + maxDim - 1) / maxDim;
+        }
+
+        // acc[i] += row[i] for n bytes. This is the only pass that touches
+        // every source byte, so it gets the vector path.
+        void AccumulateRow(uint32_t* acc, const uint8_t* row, size_t n)
+        {
+            size_t i = 0;
+#ifdef PT_HAVE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 16 <= n; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                __m128i lo = _mm_unpacklo_epi8(v, zero);
+                __m128i hi = _mm_unpackhi_epi8(v, zero);
+                __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+                _mm_storeu_si128(a + 0, _mm_add_epi32(_mm_loadu_si128(a + 0), _mm_unpacklo_epi16(lo, zero)));
+                _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+                _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+                _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+            }
+#endif
+            for (; i < n; ++i) acc[i] += row[i];
+        }
+    }
+
+    PixelBuffer DownscaleColor(const PixelBuffer& src, int maxDim, int* outScale)
+    {
+        if (src.Empty()) return {};
+        int f = ReductionFactor(src.width, src.height, maxDim);
+        if (outScale) *outScale = f;
+        if (f == 1) return src;
+
+        int dw = std::max(1, src.width / f);
+        int dh = std::max(1, src.height / f);
+        PixelBuffer dst(dw, dh);
+
+        // Only the first dw*f columns contribute; the ragged edge is dropped.
+        // A side shorter than f collapses to one pixel over what is there.
+        int usedCols = std::min(dw * f, src.width);
+        size_t used = static_cast<size_t>(usedCols) * 4;
+        std::vector<uint32_t> acc(used);
+
+        for (int dy = 0; dy < dh; ++dy)
+        {
+            std::fill(acc.begin(), acc.end(), 0u);
+            int y0 = dy * f;
+            int y1 = std::min(src.height, y0 + f);
+            for (int y = y0; y < y1; ++y)
+                AccumulateRow(acc.data(), src.Row(y), used);
+
+            uint8_t* out = dst.Row(dy);
+            for (int dx = 0; dx < dw; ++dx)
+            {
+                int cols = std::min(f, usedCols - dx * f);
+                uint32_t div = static_cast<uint32_t>((y1 - y0) * cols);
+                uint32_t s[4] = { 0, 0, 0, 0 };
+                const uint32_t* a = acc.data() + static_cast<size_t>(dx) * f * 4;
+                for (int k = 0; k < cols; ++k, a += 4)
+                {
+                    s[0] += a[0]; s[1] += a[1]; s[2] += a[2]; s[3] += a[3];
+                }
+                for (int c = 0; c < 4; ++c)
+                    out[dx * 4 + c] = static_cast<uint8_t>((s[c] + div / 2) / div);
+            }
+        }
+        return dst;
+    }
+
+    GrayImage DownscaleToGray(const PixelBuffer& src, int maxDim, int* outScale)
+    {
+        PixelBuffer small = DownscaleColor(src, maxDim, outScale);
+        GrayImage g(small.width, small.height);
+        const uint8_t* p = small.data.data();
+        uint8_t* q = g.data.data();
+        size_t n = static_cast<size_t>(small.width) * small.height;
+        for (size_t i = 0; i < n; ++i, p += 4)
+        {
+            // BT.601 luma in 8.8 fixed point: 0.114 B + 0.587 G + 0.299 R
+            q[i] = static_cast<uint8_t>((29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8);
+        }
+        return g;
+    }
+
+    std::vector<PixelBuffer> BuildPyramid(const PixelBuffer& src, int minDim)
+    {
+        std::vector<PixelBuffer> levels;
+        const PixelBuffer* prev = &src;
+        while (!prev->Empty() && std::max(prev->width, prev->height) > std::max(1, minDim))
+        {
+            // Each level halves the previous one, so the full image is read once.
+            int longest = std::max(prev->width, prev->height);
+            levels.push_back(DownscaleColor(*prev, (longest + 1) / 2));
+            prev = &levels.back();
+        }
+        return levels;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// Portable pixel containers shared by the CPU image stages.
+// Nothing in here depends on WinRT so the stages can be built and
+// measured on any platform; MainWindow converts to/from SoftwareBitmap.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    // Tightly packed 8-bit BGRA, premultiplied alpha — the same layout as
+    // SoftwareBitmap(Bgra8, Premultiplied) which is what MainWindow keeps.
+    struct PixelBuffer
+    {
+        int width{ 0 };
+        int height{ 0 };
+        std::vector<uint8_t> data;
+
+        PixelBuffer() = default;
+        PixelBuffer(int w, int h)
+            : width(w), height(h), data(static_cast<size_t>(w) * h * 4) {}
+
+        bool Empty() const { return width <= 0 || height <= 0 || data.empty(); }
+        size_t Stride() const { return static_cast<size_t>(width) * 4; }
+        uint8_t* Row(int y) { return data.data() + y * Stride(); }
+        const uint8_t* Row(int y) const { return data.data() + y * Stride(); }
+    };
+
+    // Single 8-bit channel (luminance, masks, probability maps).
+    struct GrayImage
+    {
+        int width{ 0 };
+        int height{ 0 };
+        std::vector<uint8_t> data;
+
+        GrayImage() = default;
+        GrayImage(int w, int h)
+            : width(w), height(h), data(static_cast<size_t>(w) * h) {}
+
+        bool Empty() const { return width <= 0 || height <= 0 || data.empty(); }
+        uint8_t* Row(int y) { return data.data() + static_cast<size_t>(y) * width; }
+        const uint8_t* Row(int y) const { return data.data() + static_cast<size_t>(y) * width; }
+        uint8_t At(int x, int y) const { return data[static_cast<size_t>(y) * width + x]; }
+    };
+
+    // Area-averaged downscale of src to luminance (BT.601 weights) so the
+    // longest side is at most maxDim. Returns the integer reduction factor
+    // through outScale (1 = no reduction).
+    GrayImage DownscaleToGray(const PixelBuffer& src, int maxDim, int* outScale = nullptr);
+
+    // Same reduction as DownscaleToGray but keeps colour (averaged BGRA).
+    PixelBuffer DownscaleColor(const PixelBuffer& src, int maxDim, int* outScale = nullptr);
+
+    // Successive 2x area reductions of src, finest first; level 0 (src
+    // itself) is not included. Stops once the longest side is <= minDim.
+    std::vector<PixelBuffer> BuildPyramid(const PixelBuffer& src, int minDim);
+}
@@ -0,0 +1,358 @@
+#include "PixelCache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        // Entry layout: 64-byte header, then width*height tightly packed BGRA
+        // rows. The header size keeps the pixel rows 64-byte aligned in the
+        // mapping.
+        constexpr size_t kHeaderSize = 64;
+        constexpr uint32_t kVersion = 1;
+        constexpr char kMagic[4] = { 'P', 'T', 'P', 'X' };
+        constexpr const char* kExtension = ".ptpx";
+
+        constexpr uint64_t kMul = 0x9E3779B97F4A7C15ull;
+
+        uint64_t Mix(uint64_t v)
+        {
+            v ^= v >> 30; v *= 0xBF58476D1CE4E5B9ull;
+            v ^= v >> 27; v *= 0x94D049BB133111EBull;
+            return v ^ (v >> 31);
+        }
+
+        void PutU32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i)); }
+        void PutU64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = uint8_t(v >> (8 * i)); }
+        uint32_t GetU32(const uint8_t* p) { uint32_t v = 0; for (int i = 3; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+        uint64_t GetU64(const uint8_t* p) { uint64_t v = 0; for (int i = 7; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+
+        std::string KeyName(uint64_t key)
+        {
+            char buf[17];
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(key));
+            return buf;
+        }
+
+        bool ParseKeyName(const std::string& stem, uint64_t* key)
+        {
+            if (stem.size() != 16) return false;
+            uint64_t v = 0;
+            for (char c : stem)
+            {
+                int d = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+                if (d < 0) return false;
+                v = (v << 4) | static_cast<uint64_t>(d);
+            }
+            *key = v;
+            return true;
+        }
+    }
+
+    uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+    {
+        // Four independent lanes so the multiply chains overlap; a 12 MP
+        // source hashes at memory speed.
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        uint64_t h[4] = { seed ^ kMul, seed + kMul, seed ^ (kMul >> 1), seed - kMul };
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            for (int l = 0; l < 4; ++l)
+            {
+                uint64_t v;
+                std::memcpy(&v, p + i + l * 8, 8);
+                h[l] = (h[l] ^ (v * kMul)) * 0xC2B2AE3D27D4EB4Full;
+                h[l] = (h[l] << 31) | (h[l] >> 33);
+            }
+        }
+        uint64_t tail = 0;
+        for (size_t k = 0; i < size; ++i, ++k)
+        {
+            tail |= uint64_t(p[i]) << (8 * (k & 7));
+            if ((k & 7) == 7) { h[0] = Mix(h[0] ^ tail); tail = 0; }
+        }
+        uint64_t out = Mix(h[0] ^ tail) ^ Mix(h[1] + 1) ^ Mix(h[2] + 2) ^ Mix(h[3] + 3);
+        return Mix(out ^ size);
+    }
+
+    uint64_t HashCombine(uint64_t a, uint64_t b)
+    {
+        return Mix(a ^ (b + kMul + (a << 6) + (a >> 2)));
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // MappedPixels
+    // ──────────────────────────────────────────────────────────────
+
+    std::shared_ptr<const MappedPixels> MappedPixels::Open(const fs::path& path, uint64_t key)
+    {
+        std::shared_ptr<MappedPixels> m(new MappedPixels());
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(kHeaderSize))
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);   // the mapping keeps its own reference
+        if (!mapping) return nullptr;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            CloseHandle(mapping);
+            return nullptr;
+        }
+        m->m_mapping = mapping;
+        m->m_view = view;
+        m->m_viewSize = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kHeaderSize))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) return nullptr;
+        m->m_view = view;
+        m->m_viewSize = static_cast<size_t>(st.st_size);
+#endif
+        // Validate before handing out a pointer into the mapping; from here
+        // on the destructor owns the view.
+        const uint8_t* h = static_cast<const uint8_t*>(m->m_view);
+        uint32_t w = GetU32(h + 8), ht = GetU32(h + 12);
+        if (std::memcmp(h, kMagic, 4) != 0 || GetU32(h + 4) != kVersion || GetU64(h + 16) != key ||
+            w == 0 || ht == 0 || w > 65536 || ht > 65536 ||
+            m->m_viewSize != kHeaderSize + static_cast<size_t>(w) * ht * 4)
+            return nullptr;
+
+        m->m_width = static_cast<int>(w);
+        m->m_height = static_cast<int>(ht);
+        m->m_pixels = h + kHeaderSize;
+        return m;
+    }
+
+    MappedPixels::~MappedPixels()
+    {
+        if (!m_view) return;
+#ifdef _WIN32
+        UnmapViewOfFile(m_view);
+        CloseHandle(m_mapping);
+#else
+        munmap(m_view, m_viewSize);
+#endif
+    }
+
+    PixelBuffer MappedPixels::ToPixelBuffer() const
+    {
+        PixelBuffer out(m_width, m_height);
+        std::memcpy(out.data.data(), m_pixels, Bytes());
+        return out;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // PixelCache
+    // ──────────────────────────────────────────────────────────────
+
+    PixelCache::PixelCache(fs::path directory, uint64_t capacityBytes)
+        : m_dir(std::move(directory)), m_capacity(capacityBytes)
+    {
+        std::error_code ec;
+        fs::create_directories(m_dir, ec);
+
+        // Rebuild the LRU order from file times: Find() touches the entry's
+        // write time, so the oldest file is the least recently used.
+        struct Found { fs::file_time_type time; uint64_t key; uint64_t bytes; };
+        std::vector<Found> found;
+        for (fs::directory_iterator it(m_dir, ec), end; !ec && it != end; it.increment(ec))
+        {
+            const auto& path = it->path();
+            if (path.extension() == ".tmp")
+            {
+                std::error_code rm;
+                fs::remove(path, rm);   // interrupted Store()
+                continue;
+            }
+            uint64_t key;
+            if (path.extension() != kExtension || !ParseKeyName(path.stem().string(), &key)) continue;
+            std::error_code e1, e2;
+            auto bytes = fs::file_size(path, e1);
+            auto time = fs::last_write_time(path, e2);
+            if (!e1 && !e2) found.push_back({ time, key, bytes });
+        }
+        std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.time > b.time; });
+        for (const auto& f : found)
+        {
+            m_lru.push_back(f.key);
+            m_index[f.key] = { f.bytes, std::prev(m_lru.end()) };
+            m_size += f.bytes;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        EvictLocked(0);
+    }
+
+    fs::path PixelCache::PathFor(uint64_t key) const
+    {
+        return m_dir / (KeyName(key) + kExtension);
+    }
+
+    void PixelCache::Touch(uint64_t key)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        std::error_code ec;
+        fs::last_write_time(PathFor(key), fs::file_time_type::clock::now(), ec);
+    }
+
+    std::shared_ptr<const MappedPixels> PixelCache::Find(uint64_t key)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return nullptr;
+
+        auto mapped = MappedPixels::Open(PathFor(key), key);
+        if (!mapped)
+        {
+            // Truncated or foreign file: forget it so the caller regenerates.
+            std::error_code ec;
+            fs::remove(PathFor(key), ec);
+            m_size -= it->second.bytes;
+            m_lru.erase(it->second.lru);
+            m_index.erase(it);
+            return nullptr;
+        }
+        Touch(key);
+        return mapped;
+    }
+
+    bool PixelCache::Contains(uint64_t key) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_index.count(key) != 0;
+    }
+
+    bool PixelCache::Store(uint64_t key, const PixelBuffer& pixels)
+    {
+        if (pixels.Empty()) return false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_index.count(key))
+            {
+                Touch(key);
+                return true;
+            }
+        }
+
+        // Write outside the lock; a unique temp name lets concurrent stores
+        // of the same key race harmlessly to the final rename.
+        static std::atomic<uint32_t> serial{ 0 };
+        fs::path final = PathFor(key);
+        fs::path temp = m_dir / (KeyName(key) + "-" + std::to_string(serial.fetch_add(1)) + ".tmp");
+
+        uint8_t header[kHeaderSize] = {};
+        std::memcpy(header, kMagic, 4);
+        PutU32(header + 4, kVersion);
+        PutU32(header + 8, static_cast<uint32_t>(pixels.width));
+        PutU32(header + 12, static_cast<uint32_t>(pixels.height));
+        PutU64(header + 16, key);
+        size_t bytes = static_cast<size_t>(pixels.width) * pixels.height * 4;
+        {
+            std::ofstream f(temp, std::ios::binary | std::ios::trunc);
+            f.write(reinterpret_cast<const char*>(header), kHeaderSize);
+            f.write(reinterpret_cast<const char*>(pixels.data.data()), static_cast<std::streamsize>(bytes));
+            if (!f)
+            {
+                f.close();
+                std::error_code ec;
+                fs::remove(temp, ec);
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::error_code ec;
+        fs::rename(temp, final, ec);
+        if (ec)
+        {
+            fs::remove(temp, ec);
+            return m_index.count(key) != 0;
+        }
+        if (!m_index.count(key))
+        {
+            m_lru.push_front(key);
+            m_index[key] = { kHeaderSize + bytes, m_lru.begin() };
+            m_size += kHeaderSize + bytes;
+        }
+        EvictLocked(key);
+        return true;
+    }
+
+    void PixelCache::EvictLocked(uint64_t keep)
+    {
+        auto it = m_lru.end();
+        while (m_size > m_capacity && it != m_lru.begin())
+        {
+            --it;
+            uint64_t key = *it;
+            if (key == keep) continue;
+            std::error_code ec;
+            fs::remove(PathFor(key), ec);
+            if (ec) continue;   // still mapped elsewhere (Windows); retry on a later store
+
+            m_size -= m_index[key].bytes;
+            m_index.erase(key);
+            it = m_lru.erase(it);
+        }
+    }
+
+    uint64_t PixelCache::SizeBytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_size;
+    }
+
+    uint64_t PixelCache::Capacity() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_capacity;
+    }
+
+    void PixelCache::SetCapacity(uint64_t capacityBytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = capacityBytes;
+        EvictLocked(0);
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Content-addressed on-disk cache of decoded pixels.
+//
+// Each entry is one file holding a small header and the raw BGRA rows, read
+// back through a memory mapping so a hit costs no decode and no read copy.
+// Keys are 64-bit content hashes chosen by the caller (source file bytes,
+// crop parameters, ...). The directory is capped in bytes and evicts least
+// recently used entries; recency survives restarts through file times.
+
+#include "PixelBuffer.h"
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace PassportTool::Core
+{
+    // Fast non-cryptographic 64-bit hash for cache keys.
+    uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+    uint64_t HashCombine(uint64_t a, uint64_t b);
+
+    // Read-only mapped view of a cache entry. Keeps the mapping alive for as
+    // long as the object exists.
+    class MappedPixels
+    {
+    public:
+        static std::shared_ptr<const MappedPixels> Open(const std::filesystem::path& path, uint64_t key);
+        ~MappedPixels();
+        MappedPixels(const MappedPixels&) = delete;
+        MappedPixels& operator=(const MappedPixels&) = delete;
+
+        int Width() const { return m_width; }
+        int Height() const { return m_height; }
+        const uint8_t* Data() const { return m_pixels; }
+        size_t Bytes() const { return static_cast<size_t>(m_width) * m_height * 4; }
+
+        PixelBuffer ToPixelBuffer() const;
+
+    private:
+        MappedPixels() = default;
+
+        int m_width{ 0 };
+        int m_height{ 0 };
+        const uint8_t* m_pixels{ nullptr };
+        void* m_view{ nullptr };
+        size_t m_viewSize{ 0 };
+#ifdef _WIN32
+        void* m_mapping{ nullptr };
+#endif
+    };
+
+    class PixelCache
+    {
+    public:
+        PixelCache(std::filesystem::path directory, uint64_t capacityBytes);
+
+        // Maps the entry and marks it most recently used; null on a miss or
+        // a damaged file (which is dropped).
+        std::shared_ptr<const MappedPixels> Find(uint64_t key);
+        bool Contains(uint64_t key) const;
+
+        // Writes the entry (atomically, via rename) unless it already exists,
+        // then evicts down to the capacity. Returns false on I/O failure.
+        bool Store(uint64_t key, const PixelBuffer& pixels);
+
+        uint64_t SizeBytes() const;
+        uint64_t Capacity() const;
+        void SetCapacity(uint64_t capacityBytes);
+
+    private:
+        struct Entry
+        {
+            uint64_t bytes;
+            std::list<uint64_t>::iterator lru;
+        };
+
+        std::filesystem::path PathFor(uint64_t key) const;
+        void Touch(uint64_t key);
+        void EvictLocked(uint64_t keep);
+
+        std::filesystem::path m_dir;
+        uint64_t m_capacity;
+        uint64_t m_size{ 0 };
+        std::list<uint64_t> m_lru;          // front = most recently used
+        std::unordered_map<uint64_t, Entry> m_index;
+        mutable std::mutex m_mutex;
+    };
+}
@@ -0,0 +1,201 @@
+#include "Project.h"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr const char* kHeader = "PassportToolProject";
+        constexpr int kVersion = 1;
+
+        std::string Num(double v)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.17g", v);
+            return buf;
+        }
+
+        std::string Hex(uint64_t v)
+        {
+            char buf[17];
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+            return buf;
+        }
+
+        // Values run to the end of the line; line breaks cannot appear in
+        // Windows paths or picker tokens, so they are simply dropped.
+        std::string Clean(const std::string& s)
+        {
+            std::string out;
+            for (char c : s)
+                if (c != '\n' && c != '\r') out += c;
+            return out;
+        }
+
+        bool ReadDouble(const std::string& s, double* out)
+        {
+            errno = 0;
+            char* end = nullptr;
+            double v = std::strtod(s.c_str(), &end);
+            // strtod also accepts "nan" and "inf", which no field can hold.
+            if (end == s.c_str() || *end || errno || !std::isfinite(v)) return false;
+            *out = v;
+            return true;
+        }
+
+        bool ReadInt(const std::string& s, int* out)
+        {
+            double v;
+            // Range first: casting an out-of-range double is undefined.
+            if (!ReadDouble(s, &v) || v < INT_MIN || v > INT_MAX || v != std::trunc(v)) return false;
+            *out = static_cast<int>(v);
+            return true;
+        }
+
+        // Exactly the 16 digits Hex writes: strtoull would also take
+        // whitespace, a sign or "0x", and wrap a negative value into a
+        // valid-looking key.
+        bool ReadHex(const std::string& s, uint64_t* out)
+        {
+            if (s.size() != 16) return false;
+            uint64_t v = 0;
+            for (char c : s)
+            {
+                int d;
+                if (c >= '0' && c <= '9') d = c - '0';
+                else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+                else return false;
+                v = (v << 4) | static_cast<uint64_t>(d);
+            }
+            *out = v;
+            return true;
+        }
+    }
+
+    std::string SerializeProject(const ProjectFile& p)
+    {
+        std::ostringstream o;
+        o << kHeader << ' ' << kVersion << '\n'
+          << "source.path=" << Clean(p.sourcePath) << '\n'
+          << "source.token=" << Clean(p.sourceToken) << '\n'
+          << "source.hash=" << Hex(p.sourceHash) << '\n'
+          << "source.quarterTurns=" << p.quarterTurns << '\n'
+          << "crop.zoom=" << Num(p.crop.zoom) << '\n'
+          << "crop.offsetX=" << Num(p.crop.offsetX) << '\n'
+          << "crop.offsetY=" << Num(p.crop.offsetY) << '\n'
+          << "crop.angle=" << Num(p.crop.angleDeg) << '\n'
+          << "crop.viewportW=" << Num(p.crop.viewportW) << '\n'
+          << "crop.viewportH=" << Num(p.crop.viewportH) << '\n'
+          << "unit=" << (p.metric ? "cm" : "in") << '\n'
+          << "image.width=" << Num(p.imageW) << '\n'
+          << "image.height=" << Num(p.imageH) << '\n'
+          << "sheet.width=" << Num(p.sheetW) << '\n'
+          << "sheet.height=" << Num(p.sheetH) << '\n'
+          << "sheet.gap=" << Num(p.gap) << '\n'
+          << "sheet.roll=" << (p.roll ? 1 : 0) << '\n'
+          << "sheet.rollCount=" << p.rollCount << '\n'
+          << "output.dpi=" << Num(p.dpi) << '\n'
+          << "stamp.spec=" << p.photoSpec << '\n'
+          << "stamp.whiteBackground=" << (p.whiteBackground ? 1 : 0) << '\n'
+          << "output.media=" << p.printMedia << '\n'
+          << "output.profilePath=" << Clean(p.printerProfilePath) << '\n'
+          << "output.profileToken=" << Clean(p.printerProfileToken) << '\n'
+          << "cache.stamp=" << Hex(p.stampKey) << '\n';
+        return o.str();
+    }
+
+    std::optional<ProjectFile> ParseProject(const std::string& text, std::string* error)
+    {
+        auto fail = [&](std::string msg) -> std::optional<ProjectFile> {
+            if (error) *error = std::move(msg);
+            return std::nullopt;
+        };
+
+        std::istringstream in(text);
+        std::string line;
+        if (!std::getline(in, line)) return fail("empty file");
+        std::istringstream header(line);
+        std::string magic;
+        int version = 0;
+        header >> magic >> version;
+        if (magic != kHeader) return fail("not a PassportTool project");
+        if (version < 1) return fail("unreadable project version");
+        if (version > kVersion) return fail("project was saved by a newer version");
+
+        std::map<std::string, std::string> kv;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            auto eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            kv[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+
+        ProjectFile p;
+        bool ok = true;
+        auto str = [&](const char* key, std::string* out) {
+            auto it = kv.find(key);
+            if (it != kv.end()) *out = it->second;
+            };
+        auto dbl = [&](const char* key, double* out) {
+            auto it = kv.find(key);
+            if (it != kv.end() && !ReadDouble(it->second, out)) ok = false;
+            };
+        auto num = [&](const char* key, int* out) {
+            auto it = kv.find(key);
+            if (it != kv.end() && !ReadInt(it->second, out)) ok = false;
+            };
+        auto hex = [&](const char* key, uint64_t* out) {
+            auto it = kv.find(key);
+            if (it != kv.end() && !ReadHex(it->second, out)) ok = false;
+            };
+
+        str("source.path", &p.sourcePath);
+        str("source.token", &p.sourceToken);
+        hex("source.hash", &p.sourceHash);
+        num("source.quarterTurns", &p.quarterTurns);
+        dbl("crop.zoom", &p.crop.zoom);
+        dbl("crop.offsetX", &p.crop.offsetX);
+        dbl("crop.offsetY", &p.crop.offsetY);
+        dbl("crop.angle", &p.crop.angleDeg);
+        dbl("crop.viewportW", &p.crop.viewportW);
+        dbl("crop.viewportH", &p.crop.viewportH);
+        std::string unit;
+        str("unit", &unit);
+        p.metric = (unit == "cm");
+        dbl("image.width", &p.imageW);
+        dbl("image.height", &p.imageH);
+        dbl("sheet.width", &p.sheetW);
+        dbl("sheet.height", &p.sheetH);
+        dbl("sheet.gap", &p.gap);
+        int roll = 0;
+        num("sheet.roll", &roll);
+        p.roll = roll != 0;
+        num("sheet.rollCount", &p.rollCount);
+        dbl("output.dpi", &p.dpi);
+        num("stamp.spec", &p.photoSpec);
+        int white = 0;
+        num("stamp.whiteBackground", &white);
+        p.whiteBackground = white != 0;
+        num("output.media", &p.printMedia);
+        str("output.profilePath", &p.printerProfilePath);
+        str("output.profileToken", &p.printerProfileToken);
+        hex("cache.stamp", &p.stampKey);
+
+        if (!ok) return fail("malformed value");
+        // A job can reopen from the pixel cache alone, so the hash suffices.
+        if (p.sourcePath.empty() && p.sourceToken.empty() && !p.sourceHash) return fail("no source image");
+        p.quarterTurns = ((p.quarterTurns % 4) + 4) % 4;
+        if (!(p.crop.zoom > 0)) p.crop.zoom = 1;
+        if (p.rollCount < 1) p.rollCount = 1;
+        return p;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Saved job ("project") file: where the source came from, how it was framed
+// and the sheet/stamp settings, plus the cache keys that let a reopen skip
+// decoding and re-capturing.
+//
+// The format is line-oriented UTF-8 text, "key=value" after a
+// "PassportToolProject <version>" header. Unknown keys are ignored so newer
+// files still open in older builds.
+
+#include "Transform.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace PassportTool::Core
+{
+    struct ProjectFile
+    {
+        // Source image. The token is the app's future-access handle; the path
+        // is a fallback and for display.
+        std::string sourcePath;
+        std::string sourceToken;
+        uint64_t sourceHash{ 0 };     // HashBytes of the encoded file
+        int quarterTurns{ 0 };        // clockwise Rotate 90° presses, 0..3
+
+        // Crop viewport state; viewport size is the DIP size it was taken at.
+        CropTransform crop;
+
+        // Stamp and sheet, in the project's unit.
+        bool metric{ false };
+        double imageW{ 2 }, imageH{ 2 };
+        double sheetW{ 6 }, sheetH{ 4 };
+        double gap{ 0 };
+        bool roll{ false };           // roll media: sheetW is the roll width, sheetH unused
+        int rollCount{ 24 };          // stamps on the roll
+        double dpi{ 300 };
+        int photoSpec{ 0 };
+        bool whiteBackground{ false };
+        int printMedia{ 0 };
+        std::string printerProfilePath;
+        std::string printerProfileToken;
+
+        // Cache key of the captured (unprocessed) stamp; 0 if none.
+        uint64_t stampKey{ 0 };
+    };
+
+    std::string SerializeProject(const ProjectFile& project);
+    std::optional<ProjectFile> ParseProject(const std::string& text, std::string* error = nullptr);
+}
@@ -0,0 +1,666 @@
+#include "Raster.h"
+#include "SheetCompositor.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <new>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr size_t kPwgHeaderSize = 1796;
+        constexpr size_t kUrfHeaderSize = 32;
+        constexpr size_t kDrainBytes = 64 * 1024;
+        constexpr size_t kMaxDecodedPageBytes = size_t(1) << 30;   // receiver-side sanity cap
+
+        // cups_page_header2_t offsets used by PWG 5102.4.
+        constexpr size_t kPwgMediaClass = 0;
+        constexpr size_t kPwgHWResolution = 276;
+        constexpr size_t kPwgNumCopies = 340;
+        constexpr size_t kPwgPageSize = 352;
+        constexpr size_t kPwgWidth = 372;
+        constexpr size_t kPwgHeight = 376;
+        constexpr size_t kPwgBitsPerColor = 384;
+        constexpr size_t kPwgBitsPerPixel = 388;
+        constexpr size_t kPwgBytesPerLine = 392;
+        constexpr size_t kPwgColorSpace = 400;
+        constexpr size_t kPwgNumColors = 420;
+        constexpr size_t kPwgTotalPageCount = 452;      // cupsInteger[0]
+        constexpr size_t kPwgCrossFeedTransform = 456;  // cupsInteger[1]
+        constexpr size_t kPwgFeedTransform = 460;       // cupsInteger[2]
+        constexpr size_t kPwgPageSizeName = 1732;
+        constexpr uint32_t kPwgRgb = 1;        // device RGB
+        constexpr uint32_t kPwgSrgb = 19;
+
+        constexpr uint8_t kUrfSrgb = 1;
+        constexpr uint8_t kUrfRgb = 5;         // device RGB
+        constexpr uint8_t kUrfSimplex = 1;
+        constexpr uint8_t kUrfNormalQuality = 4;
+
+        void PutBE32(uint8_t* p, uint32_t v)
+        {
+            p[0] = static_cast<uint8_t>(v >> 24);
+            p[1] = static_cast<uint8_t>(v >> 16);
+            p[2] = static_cast<uint8_t>(v >> 8);
+            p[3] = static_cast<uint8_t>(v);
+        }
+
+        uint32_t GetBE32(const uint8_t* p)
+        {
+            return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+
+        void PutString(uint8_t* p, size_t cap, const char* s)
+        {
+            std::memcpy(p, s, std::min(std::strlen(s), cap - 1));
+        }
+
+        bool SamePixel(const uint8_t* a, const uint8_t* b)
+        {
+            return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+        }
+
+        // One line as PackBits runs of 3-byte pixels: 0..127 repeats the next
+        // pixel n+1 times, 129..255 is followed by 257-n literal pixels. Runs
+        // of one are written as repeats, so literals are always 2..128 long.
+        void EncodeLine(const uint8_t* rgb, int width, std::vector<uint8_t>& out)
+        {
+            int i = 0;
+            while (i < width)
+            {
+                const uint8_t* px = rgb + i * 3;
+                int run = 1;
+                while (i + run < width && run < 128 && SamePixel(px, rgb + (i + run) * 3)) ++run;
+                if (run >= 2 || i + 1 == width)
+                {
+                    out.push_back(static_cast<uint8_t>(run - 1));
+                    out.insert(out.end(), px, px + 3);
+                    i += run;
+                    continue;
+                }
+
+                // Literal: stop before the next pair of equal pixels.
+                int count = 1;
+                while (i + count < width && count < 128)
+                {
+                    const uint8_t* q = rgb + (i + count) * 3;
+                    if (i + count + 1 < width && SamePixel(q, q + 3)) break;
+                    ++count;
+                }
+                if (count == 1)
+                {
+                    out.push_back(0);
+                    out.insert(out.end(), px, px + 3);
+                }
+                else
+                {
+                    out.push_back(static_cast<uint8_t>(257 - count));
+                    out.insert(out.end(), px, px + count * 3);
+                }
+                i += count;
+            }
+        }
+
+        // Alpha is dropped: sheets are opaque, and the premultiplied white
+        // fill stays white.
+        void BgraToRgb(const uint8_t* bgra, int width, uint8_t* rgb)
+        {
+            for (int x = 0; x < width; ++x, bgra += 4, rgb += 3)
+            {
+                rgb[0] = bgra[2];
+                rgb[1] = bgra[1];
+                rgb[2] = bgra[0];
+            }
+        }
+
+        // PWG self-describing media name, e.g. "custom_sheet_6x4in".
+        std::string PageSizeName(const std::string& media, int width, int height, int dpi)
+        {
+            auto inches = [&](int px) {
+                char buf[32];
+                std::snprintf(buf, sizeof(buf), "%.4g", static_cast<double>(px) / dpi);
+                return std::string(buf);
+                };
+            return "custom_" + media + "_" + inches(width) + "x" + inches(height) + "in";
+        }
+
+#ifdef _WIN32
+        using NativeSocket = SOCKET;
+        constexpr NativeSocket kNoSocket = INVALID_SOCKET;
+
+        bool EnsureSockets()
+        {
+            static const bool ok = [] {
+                WSADATA data;
+                return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+                }();
+            return ok;
+        }
+
+        void CloseSocket(NativeSocket s) { closesocket(s); }
+
+        bool SetBlocking(NativeSocket s, bool blocking)
+        {
+            u_long nonBlocking = blocking ? 0 : 1;
+            return ioctlsocket(s, FIONBIO, &nonBlocking) == 0;
+        }
+
+        bool ConnectPending() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+
+        bool SetSendTimeout(NativeSocket s, int timeoutMs)
+        {
+            DWORD ms = static_cast<DWORD>(timeoutMs);
+            return setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&ms), sizeof(ms)) == 0;
+        }
+
+        // Waits for a non-blocking connect; true once it has succeeded.
+        bool WaitConnected(NativeSocket s, int timeoutMs)
+        {
+            fd_set writable, failed;
+            FD_ZERO(&writable);
+            FD_ZERO(&failed);
+            FD_SET(s, &writable);
+            FD_SET(s, &failed);
+            timeval tv{ timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+            return select(0, nullptr, &writable, &failed, &tv) > 0 && FD_ISSET(s, &writable);
+        }
+
+        int SendSome(NativeSocket s, const uint8_t* data, int size)
+        {
+            return send(s, reinterpret_cast<const char*>(data), size, 0);
+        }
+
+        bool Interrupted() { return WSAGetLastError() == WSAEINTR; }
+#else
+        using NativeSocket = int;
+        constexpr NativeSocket kNoSocket = -1;
+
+        bool EnsureSockets() { return true; }
+        void CloseSocket(NativeSocket s) { ::close(s); }
+
+        bool SetBlocking(NativeSocket s, bool blocking)
+        {
+            int flags = fcntl(s, F_GETFL, 0);
+            if (flags < 0) return false;
+            flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+            return fcntl(s, F_SETFL, flags) == 0;
+        }
+
+        bool ConnectPending() { return errno == EINPROGRESS || errno == EINTR; }
+
+        bool SetSendTimeout(NativeSocket s, int timeoutMs)
+        {
+            timeval tv{ timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+            return setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == 0;
+        }
+
+        bool WaitConnected(NativeSocket s, int timeoutMs)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            for (;;)
+            {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now()).count();
+                if (left <= 0) return false;
+                pollfd pfd{ s, POLLOUT, 0 };
+                int ready = poll(&pfd, 1, static_cast<int>(left));
+                if (ready < 0 && errno == EINTR) continue;
+                if (ready <= 0) return false;
+                int error = 0;
+                socklen_t len = sizeof(error);
+                return getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+            }
+        }
+
+        int SendSome(NativeSocket s, const uint8_t* data, int size)
+        {
+            return static_cast<int>(send(s, data, size, MSG_NOSIGNAL));
+        }
+
+        bool Interrupted() { return errno == EINTR; }
+#endif
+    }
+
+    // ────────────────────────────────────────────────────────────────
+    // Sinks
+    // ────────────────────────────────────────────────────────────────
+
+    FileSink::FileSink(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        m_file = _wfopen(path.c_str(), L"wb");
+#else
+        m_file = std::fopen(path.c_str(), "wb");
+#endif
+    }
+
+    FileSink::~FileSink()
+    {
+        if (m_file) std::fclose(m_file);
+    }
+
+    bool FileSink::Write(const uint8_t* data, size_t size)
+    {
+        return m_file && std::fwrite(data, 1, size, m_file) == size;
+    }
+
+    bool FileSink::Flush()
+    {
+        return m_file && std::fflush(m_file) == 0;
+    }
+
+    std::unique_ptr<SocketSink> SocketSink::Connect(const std::string& host, uint16_t port, std::string* error,
+        int timeoutMs)
+    {
+        auto fail = [&](std::string msg) -> std::unique_ptr<SocketSink> {
+            if (error) *error = std::move(msg);
+            return nullptr;
+        };
+        if (!EnsureSockets()) return fail("socket library unavailable");
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        std::string service = std::to_string(port);
+        if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) != 0 || !found)
+            return fail("cannot resolve " + host);
+
+        // Non-blocking connect so an address that never answers fails after
+        // timeoutMs rather than the system's multi-minute default.
+        timeoutMs = std::max(1, timeoutMs);
+        NativeSocket s = kNoSocket;
+        bool timedOut = false;
+        for (addrinfo* a = found; a; a = a->ai_next)
+        {
+            s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (s == kNoSocket) continue;
+            if (SetBlocking(s, false))
+            {
+                bool connected = connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0;
+                if (!connected && ConnectPending())
+                {
+                    connected = WaitConnected(s, timeoutMs);
+                    timedOut = timedOut || !connected;
+                }
+                if (connected && SetBlocking(s, true) && SetSendTimeout(s, timeoutMs)) break;
+            }
+            CloseSocket(s);
+            s = kNoSocket;
+        }
+        freeaddrinfo(found);
+        if (s == kNoSocket)
+            return fail((timedOut ? "timed out connecting to " : "cannot connect to ") + host + ":" + service);
+
+        std::unique_ptr<SocketSink> sink(new SocketSink());
+        sink->m_socket = static_cast<intptr_t>(s);
+        return sink;
+    }
+
+    SocketSink::~SocketSink()
+    {
+        if (m_socket != -1) CloseSocket(static_cast<NativeSocket>(m_socket));
+    }
+
+    bool SocketSink::Write(const uint8_t* data, size_t size)
+    {
+        auto s = static_cast<NativeSocket>(m_socket);
+        while (size > 0)
+        {
+            int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+            int sent = SendSome(s, data, chunk);
+            if (sent < 0 && Interrupted()) continue;
+            // Anything else, the SO_SNDTIMEO timeout included, fails the job.
+            if (sent <= 0) return false;
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    bool ParseHostPort(const std::string& text, std::string* host, uint16_t* port)
+    {
+        std::string h = text;
+        long p = 9100;
+        auto colon = text.rfind(':');
+        if (colon != std::string::npos && text.find(':') == colon)
+        {
+            h = text.substr(0, colon);
+            char* end = nullptr;
+            p = std::strtol(text.c_str() + colon + 1, &end, 10);
+            if (*end || p <= 0 || p > 65535) return false;
+        }
+        if (h.empty()) return false;
+        *host = h;
+        *port = static_cast<uint16_t>(p);
+        return true;
+    }
+
+    // ────────────────────────────────────────────────────────────────
+    // Writer
+    // ────────────────────────────────────────────────────────────────
+
+    RasterWriter::RasterWriter(ByteSink& sink, RasterFormat format, RasterColor color, int totalPages)
+        : m_sink(sink), m_format(format), m_color(color), m_totalPages(totalPages)
+    {
+    }
+
+    bool RasterWriter::BeginPage(int width, int height, int dpi, const char* media)
+    {
+        if (!m_ok || width <= 0 || height <= 0 || dpi <= 0) return false;
+        if (!m_started)
+        {
+            m_started = true;
+            if (m_format == RasterFormat::Pwg)
+            {
+                Emit(reinterpret_cast<const uint8_t*>("RaS2"), 4);
+            }
+            else
+            {
+                uint8_t head[12] = { 'U', 'N', 'I', 'R', 'A', 'S', 'T', 0 };
+                PutBE32(head + 8, static_cast<uint32_t>(m_totalPages));
+                Emit(head, sizeof(head));
+            }
+        }
+        m_width = width;
+        m_height = height;
+        m_dpi = dpi;
+        m_media = media ? media : "sheet";
+        m_rowsIn = 0;
+        m_repeat = -1;
+        m_line.assign(static_cast<size_t>(width) * 3, 0);
+        m_next.assign(static_cast<size_t>(width) * 3, 0);
+        return WriteHeader();
+    }
+
+    bool RasterWriter::WriteHeader()
+    {
+        const bool device = m_color == RasterColor::DeviceRgb;
+        if (m_format == RasterFormat::Urf)
+        {
+            uint8_t h[kUrfHeaderSize] = {};
+            h[0] = 24;
+            h[1] = device ? kUrfRgb : kUrfSrgb;
+            h[2] = kUrfSimplex;
+            h[3] = kUrfNormalQuality;
+            PutBE32(h + 12, static_cast<uint32_t>(m_width));
+            PutBE32(h + 16, static_cast<uint32_t>(m_height));
+            PutBE32(h + 20, static_cast<uint32_t>(m_dpi));
+            return Emit(h, sizeof(h));
+        }
+
+        uint8_t h[kPwgHeaderSize] = {};
+        PutString(h + kPwgMediaClass, 64, "PwgRaster");
+        PutBE32(h + kPwgHWResolution, static_cast<uint32_t>(m_dpi));
+        PutBE32(h + kPwgHWResolution + 4, static_cast<uint32_t>(m_dpi));
+        PutBE32(h + kPwgNumCopies, 1);
+        // PageSize is in points.
+        PutBE32(h + kPwgPageSize, static_cast<uint32_t>(std::lround(m_width * 72.0 / m_dpi)));
+        PutBE32(h + kPwgPageSize + 4, static_cast<uint32_t>(std::lround(m_height * 72.0 / m_dpi)));
+        PutBE32(h + kPwgWidth, static_cast<uint32_t>(m_width));
+        PutBE32(h + kPwgHeight, static_cast<uint32_t>(m_height));
+        PutBE32(h + kPwgBitsPerColor, 8);
+        PutBE32(h + kPwgBitsPerPixel, 24);
+        PutBE32(h + kPwgBytesPerLine, static_cast<uint32_t>(m_width) * 3);
+        PutBE32(h + kPwgColorSpace, device ? kPwgRgb : kPwgSrgb);
+        PutBE32(h + kPwgNumColors, 3);
+        PutBE32(h + kPwgTotalPageCount, static_cast<uint32_t>(m_totalPages));
+        PutBE32(h + kPwgCrossFeedTransform, 1);
+        PutBE32(h + kPwgFeedTransform, 1);
+        PutString(h + kPwgPageSizeName, 64, PageSizeName(m_media, m_width, m_height, m_dpi).c_str());
+        return Emit(h, sizeof(h));
+    }
+
+    bool RasterWriter::WriteRows(const uint8_t* bgra, size_t stride, int rows)
+    {
+        if (!m_ok) return false;
+        rows = std::min(rows, m_height - m_rowsIn);
+        for (int r = 0; r < rows; ++r, bgra += stride)
+        {
+            BgraToRgb(bgra, m_width, m_next.data());
+            // Identical rows (sheet margins, gaps) fold into the repeat byte.
+            if (m_repeat >= 0 && m_repeat < 255 && m_next == m_line)
+            {
+                ++m_repeat;
+                continue;
+            }
+            if (m_repeat >= 0) FlushLine();
+            m_line.swap(m_next);
+            m_repeat = 0;
+        }
+        m_rowsIn += rows;
+        return m_out.size() < kDrainBytes ? m_ok : Drain();
+    }
+
+    void RasterWriter::FlushLine()
+    {
+        m_out.push_back(static_cast<uint8_t>(m_repeat));
+        EncodeLine(m_line.data(), m_width, m_out);
+        m_repeat = -1;
+    }
+
+    bool RasterWriter::EndPage()
+    {
+        if (!m_ok) return false;
+        // Short pages are padded with white so the header stays truthful.
+        if (m_rowsIn < m_height)
+        {
+            std::vector<uint8_t> white(static_cast<size_t>(m_width) * 4, 255);
+            while (m_rowsIn < m_height) WriteRows(white.data(), 0, m_height - m_rowsIn);
+        }
+        if (m_repeat >= 0) FlushLine();
+        return Drain() && m_sink.Flush();
+    }
+
+    bool RasterWriter::Emit(const uint8_t* data, size_t size)
+    {
+        m_out.insert(m_out.end(), data, data + size);
+        return m_out.size() < kDrainBytes ? m_ok : Drain();
+    }
+
+    bool RasterWriter::Drain()
+    {
+        if (m_ok && !m_out.empty())
+        {
+            m_ok = m_sink.Write(m_out.data(), m_out.size());
+            if (m_ok) m_written += m_out.size();
+        }
+        m_out.clear();
+        return m_ok;
+    }
+
+    namespace
+    {
+        // One page of width x height, filled bandRows at a time by compose.
+        bool StreamBands(int width, int height, int dpi, const char* media, RasterFormat format, RasterColor color,
+            ByteSink& sink, int bandRows, const std::function<void(int y0, PixelBuffer& band)>& compose)
+        {
+            if (width <= 0 || height <= 0) return false;
+            RasterWriter writer(sink, format, color, 1);
+            if (!writer.BeginPage(width, height, dpi, media)) return false;
+            PixelBuffer band(width, std::min(std::max(1, bandRows), height));
+            for (int y = 0; y < height; y += band.height)
+            {
+                int rows = std::min(band.height, height - y);
+                compose(y, band);
+                if (!writer.WriteRows(band.data.data(), band.Stride(), rows)) return false;
+            }
+            return writer.EndPage();
+        }
+    }
+
+    bool StreamSheet(const LayoutResult& layout, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp,
+        RasterFormat format, RasterColor color, int dpi, ByteSink& sink, int bandRows)
+    {
+        TraceSpan span("raster.stream");
+        const auto& m = layout.metrics;
+        PlacementIndex index(layout.placements);
+        return StreamBands(m.sheetW, m.sheetH, dpi, "sheet", format, color, sink, bandRows, [&](int y0, PixelBuffer& band) {
+            ComposeBand(index, stamp, rotatedStamp, y0, band);
+            });
+    }
+
+    bool StreamRoll(const RollLayout& roll, uint64_t count, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp,
+        RasterFormat format, RasterColor color, int dpi, ByteSink& sink, int bandRows)
+    {
+        TraceSpan span("raster.stream_roll");
+        int64_t length = roll.LengthFor(count);
+        if (length <= 0 || length > INT_MAX) return false;
+
+        std::vector<ImagePlacement> placements;
+        return StreamBands(roll.Unit().metrics.sheetW, static_cast<int>(length), dpi, "roll", format, color, sink, bandRows,
+            [&](int y0, PixelBuffer& band) {
+                placements.clear();
+                roll.PlacementsInRows(y0, y0 + band.height, count, placements);
+                ComposeBand(placements, stamp, rotatedStamp, 0, band);
+            });
+    }
+
+    // ────────────────────────────────────────────────────────────────
+    // Decoder
+    // ────────────────────────────────────────────────────────────────
+
+    std::optional<std::vector<RasterPage>> DecodeRaster(const uint8_t* data, size_t size, std::string* error)
+    {
+        auto fail = [&](std::string msg) -> std::optional<std::vector<RasterPage>> {
+            if (error) *error = std::move(msg);
+            return std::nullopt;
+        };
+
+        RasterFormat format;
+        size_t pos;
+        if (size >= 4 && std::memcmp(data, "RaS2", 4) == 0)
+        {
+            format = RasterFormat::Pwg;
+            pos = 4;
+        }
+        else if (size >= 12 && std::memcmp(data, "UNIRAST", 8) == 0)
+        {
+            format = RasterFormat::Urf;
+            pos = 12;
+        }
+        else
+        {
+            return fail("not a PWG or URF stream");
+        }
+
+        std::vector<RasterPage> pages;
+        while (pos < size)
+        {
+            RasterPage page;
+            int bitsPerPixel;
+            if (format == RasterFormat::Pwg)
+            {
+                if (size - pos < kPwgHeaderSize) return fail("truncated page header");
+                const uint8_t* h = data + pos;
+                page.width = static_cast<int>(GetBE32(h + kPwgWidth));
+                page.height = static_cast<int>(GetBE32(h + kPwgHeight));
+                page.dpi = static_cast<int>(GetBE32(h + kPwgHWResolution));
+                bitsPerPixel = static_cast<int>(GetBE32(h + kPwgBitsPerPixel));
+                uint32_t colorSpace = GetBE32(h + kPwgColorSpace);
+                if (colorSpace != kPwgSrgb && colorSpace != kPwgRgb) return fail("unsupported colour space");
+                page.color = colorSpace == kPwgRgb ? RasterColor::DeviceRgb : RasterColor::Srgb;
+                pos += kPwgHeaderSize;
+            }
+            else
+            {
+                if (size - pos < kUrfHeaderSize) return fail("truncated page header");
+                const uint8_t* h = data + pos;
+                bitsPerPixel = h[0];
+                uint8_t colorSpace = h[1];
+                if (colorSpace != kUrfSrgb && colorSpace != kUrfRgb) return fail("unsupported colour space");
+                page.color = colorSpace == kUrfRgb ? RasterColor::DeviceRgb : RasterColor::Srgb;
+                page.width = static_cast<int>(GetBE32(h + 12));
+                page.height = static_cast<int>(GetBE32(h + 16));
+                page.dpi = static_cast<int>(GetBE32(h + 20));
+                pos += kUrfHeaderSize;
+            }
+            if (bitsPerPixel != 24) return fail("only 24-bit RGB pages are supported");
+            if (page.width <= 0 || page.height <= 0 || page.width > 1 << 20 || page.height > 1 << 20)
+                return fail("bad page size");
+
+            // Every group of up to 256 lines costs at least a repeat byte and
+            // one run byte, so a header claiming more lines than the data
+            // can hold is rejected before anything is allocated.
+            size_t lineBytes = static_cast<size_t>(page.width) * 3;
+            size_t minEncoded = (static_cast<size_t>(page.height) + 255) / 256 * 2;
+            if (minEncoded > size - pos) return fail("truncated page data");
+            if (lineBytes * page.height > kMaxDecodedPageBytes) return fail("page too large to decode");
+            try
+            {
+                page.rgb.resize(lineBytes * page.height);
+            }
+            catch (const std::bad_alloc&)
+            {
+                return fail("page too large to decode");
+            }
+            int y = 0;
+            while (y < page.height)
+            {
+                if (pos >= size) return fail("truncated page data");
+                int copies = data[pos++] + 1;
+                uint8_t* line = page.rgb.data() + y * lineBytes;
+                size_t x = 0;
+                while (x < lineBytes)
+                {
+                    if (pos >= size) return fail("truncated line");
+                    uint8_t n = data[pos++];
+                    if (n == 128)
+                    {
+                        // Fill the rest of the line with white.
+                        std::memset(line + x, 255, lineBytes - x);
+                        x = lineBytes;
+                    }
+                    else if (n < 128)
+                    {
+                        size_t count = size_t(n) + 1;
+                        if (pos + 3 > size || x + count * 3 > lineBytes) return fail("bad run");
+                        for (size_t i = 0; i < count; ++i, x += 3) std::memcpy(line + x, data + pos, 3);
+                        pos += 3;
+                    }
+                    else
+                    {
+                        size_t bytes = (257 - size_t(n)) * 3;
+                        if (pos + bytes > size || x + bytes > lineBytes) return fail("bad literal");
+                        std::memcpy(line + x, data + pos, bytes);
+                        pos += bytes;
+                        x += bytes;
+                    }
+                }
+                copies = std::min(copies, page.height - y);
+                for (int c = 1; c < copies; ++c) std::memcpy(line + c * lineBytes, line, lineBytes);
+                y += copies;
+            }
+            pages.push_back(std::move(page));
+        }
+        return pages;
+    }
+}
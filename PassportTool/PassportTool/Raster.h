@@ -0,0 +1,137 @@
+#pragma once
+
+// Printer-ready raster output: PWG Raster (PWG 5102.4) and Apple URF.
+//
+// Both formats share the same line compression: a line-repeat byte, then
+// PackBits-style runs of whole pixels. The writer takes the sheet as a
+// sequence of row bands, so a sheet goes from layout to printer bytes
+// without ever existing as a full image (see StreamSheet).
+
+#include "Layout.h"
+#include "PixelBuffer.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    enum class RasterFormat
+    {
+        Pwg,    // "RaS2" + 1796-byte page headers, RGB 8-bit
+        Urf,    // "UNIRAST" + 32-byte page headers, RGB 8-bit
+    };
+
+    // Colour space the page headers declare. Pixels already converted with
+    // a printer profile are device RGB, so the printer must not convert
+    // them from sRGB a second time.
+    enum class RasterColor
+    {
+        Srgb,
+        DeviceRgb,
+    };
+
+    // Destination for the byte stream. Write returns false once the
+    // destination has failed; the writer stops at the first failure.
+    class ByteSink
+    {
+    public:
+        virtual ~ByteSink() = default;
+        virtual bool Write(const uint8_t* data, size_t size) = 0;
+        virtual bool Flush() { return true; }
+    };
+
+    class FileSink : public ByteSink
+    {
+    public:
+        explicit FileSink(const std::filesystem::path& path);
+        ~FileSink() override;
+        bool Ok() const { return m_file != nullptr; }
+        bool Write(const uint8_t* data, size_t size) override;
+        bool Flush() override;
+
+    private:
+        std::FILE* m_file{ nullptr };
+    };
+
+    // TCP client, e.g. a printer's raw port or the local stand-in receiver.
+    // Connecting and each send give up after timeoutMs, so a printer that
+    // stops reading fails the job instead of holding a worker forever.
+    class SocketSink : public ByteSink
+    {
+    public:
+        static constexpr int kDefaultTimeoutMs = 30000;
+
+        static std::unique_ptr<SocketSink> Connect(const std::string& host, uint16_t port, std::string* error = nullptr,
+            int timeoutMs = kDefaultTimeoutMs);
+        ~SocketSink() override;
+        bool Write(const uint8_t* data, size_t size) override;
+
+    private:
+        SocketSink() = default;
+        intptr_t m_socket{ -1 };
+    };
+
+    // Parses "host:port"; the port defaults to 9100 (raw printing).
+    bool ParseHostPort(const std::string& text, std::string* host, uint16_t* port);
+
+    class RasterWriter
+    {
+    public:
+        RasterWriter(ByteSink& sink, RasterFormat format, RasterColor color, int totalPages);
+
+        // media names the PWG page size, "custom_<media>_WxHin".
+        bool BeginPage(int width, int height, int dpi, const char* media = "sheet");
+        // Appends rows of tightly packed BGRA (alpha ignored), top-down.
+        bool WriteRows(const uint8_t* bgra, size_t stride, int rows);
+        bool EndPage();
+
+        uint64_t BytesWritten() const { return m_written; }
+
+    private:
+        bool WriteHeader();
+        void FlushLine();
+        bool Emit(const uint8_t* data, size_t size);
+        bool Drain();
+
+        ByteSink& m_sink;
+        RasterFormat m_format;
+        RasterColor m_color;
+        int m_totalPages;
+        bool m_started{ false };
+        bool m_ok{ true };
+        int m_width{ 0 }, m_height{ 0 }, m_dpi{ 0 };
+        std::string m_media;
+        int m_rowsIn{ 0 };
+        std::vector<uint8_t> m_line;        // pending RGB line
+        std::vector<uint8_t> m_next;        // conversion scratch
+        int m_repeat{ -1 };                 // extra copies of m_line; -1 = none pending
+        std::vector<uint8_t> m_out;         // encoded bytes not yet handed to the sink
+        uint64_t m_written{ 0 };
+    };
+
+    // Composes the sheet band by band (bandRows at a time) and streams it
+    // as one raster page. Peak memory is one band plus the stamps.
+    bool StreamSheet(const LayoutResult& layout, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp,
+        RasterFormat format, RasterColor color, int dpi, ByteSink& sink, int bandRows = 128);
+
+    // Streams the first `count` stamps of a roll as one continuous page.
+    // Placements are generated per band, so memory does not grow with count.
+    bool StreamRoll(const RollLayout& roll, uint64_t count, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp,
+        RasterFormat format, RasterColor color, int dpi, ByteSink& sink, int bandRows = 128);
+
+    // Decoder used by the stand-in receiver and for round-trip checks.
+    struct RasterPage
+    {
+        int width{ 0 };
+        int height{ 0 };
+        int dpi{ 0 };
+        RasterColor color{ RasterColor::Srgb };
+        std::vector<uint8_t> rgb;   // width * height * 3
+    };
+
+    std::optional<std::vector<RasterPage>> DecodeRaster(const uint8_t* data, size_t size, std::string* error = nullptr);
+}
@@ -0,0 +1,197 @@
+#include "Sharpen.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PT_HAVE_SSE2 1
+#endif
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        std::vector<float> GaussianKernel(double sigma, int& radius)
+        {
+            radius = std::max(1, static_cast<int>(std::ceil(sigma * 3.0)));
+            std::vector<float> k(2 * radius + 1);
+            double sum = 0.0;
+            for (int i = -radius; i <= radius; ++i)
+            {
+                double v = std::exp(-(i * i) / (2.0 * sigma * sigma));
+                k[i + radius] = static_cast<float>(v);
+                sum += v;
+            }
+            for (auto& v : k) v = static_cast<float>(v / sum);
+            return k;
+        }
+
+        // dst[i] = sum_k w[k] * src[k][i] over n floats, for the 2r+1 taps of
+        // a symmetric kernel: mirrored taps are added before the multiply,
+        // which halves the multiplies. Taps accumulate in registers so each
+        // output is stored once.
+        void Convolve(float* dst, const float* const* src, const float* w, int r, size_t n)
+        {
+            size_t i = 0;
+#ifdef PT_HAVE_SSE2
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 acc = _mm_mul_ps(_mm_set1_ps(w[r]), _mm_loadu_ps(src[r] + i));
+                for (int k = 0; k < r; ++k)
+                {
+                    __m128 pair = _mm_add_ps(_mm_loadu_ps(src[k] + i), _mm_loadu_ps(src[2 * r - k] + i));
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), pair));
+                }
+                _mm_storeu_ps(dst + i, acc);
+            }
+#endif
+            for (; i < n; ++i)
+            {
+                float acc = w[r] * src[r][i];
+                for (int k = 0; k < r; ++k) acc += w[k] * (src[k][i] + src[2 * r - k][i]);
+                dst[i] = acc;
+            }
+        }
+
+        // One BGRA row to floats with r clamped pixels of padding each side.
+        void ToFloat(float* dst, const uint8_t* src, int w, int r)
+        {
+            for (int x = -r; x < 0; ++x, dst += 4)
+                for (int c = 0; c < 4; ++c) dst[c] = src[c];
+            int x = 0;
+#ifdef PT_HAVE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 4 <= w; x += 4, dst += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+                __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+                _mm_storeu_ps(dst + 0, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+                _mm_storeu_ps(dst + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+                _mm_storeu_ps(dst + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+                _mm_storeu_ps(dst + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+            }
+#endif
+            for (; x < w; ++x, dst += 4)
+                for (int c = 0; c < 4; ++c) dst[c] = src[x * 4 + c];
+            const uint8_t* last = src + (w - 1) * 4;
+            for (int k = 0; k < r; ++k, dst += 4)
+                for (int c = 0; c < 4; ++c) dst[c] = last[c];
+        }
+
+        // p += amount * (p - blur) for colour channels whose difference
+        // exceeds the threshold, clamped to alpha (premultiplied: colour <=
+        // alpha). Alpha is left untouched.
+        void BlendRow(uint8_t* row, const float* blur, int w, float amount, float threshold)
+        {
+            int x = 0;
+#ifdef PT_HAVE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 amt = _mm_set1_ps(amount);
+            const __m128 thr = _mm_setr_ps(threshold, threshold, threshold, 1e30f);   // never alpha
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            const __m128 half = _mm_set1_ps(0.5f);
+            auto one = [&](__m128i px, const float* b) {
+                __m128 v = _mm_cvtepi32_ps(px);
+                __m128 diff = _mm_sub_ps(v, _mm_loadu_ps(b));
+                __m128 apply = _mm_cmpgt_ps(_mm_and_ps(diff, absMask), thr);
+                __m128 alpha = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+                __m128 sharp = _mm_min_ps(_mm_max_ps(_mm_add_ps(v, _mm_mul_ps(amt, diff)), _mm_setzero_ps()), alpha);
+                __m128 out = _mm_or_ps(_mm_and_ps(apply, sharp), _mm_andnot_ps(apply, v));
+                return _mm_cvttps_epi32(_mm_add_ps(out, half));
+            };
+            for (; x + 4 <= w; x += 4)
+            {
+                __m128i* p = reinterpret_cast<__m128i*>(row + x * 4);
+                const float* b = blur + static_cast<size_t>(x) * 4;
+                __m128i v = _mm_loadu_si128(p);
+                __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+                __m128i o0 = one(_mm_unpacklo_epi16(lo, zero), b);
+                __m128i o1 = one(_mm_unpackhi_epi16(lo, zero), b + 4);
+                __m128i o2 = one(_mm_unpacklo_epi16(hi, zero), b + 8);
+                __m128i o3 = one(_mm_unpackhi_epi16(hi, zero), b + 12);
+                _mm_storeu_si128(p, _mm_packus_epi16(_mm_packs_epi32(o0, o1), _mm_packs_epi32(o2, o3)));
+            }
+#endif
+            for (; x < w; ++x)
+            {
+                uint8_t* p = row + x * 4;
+                const float* b = blur + static_cast<size_t>(x) * 4;
+                int a = p[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    float diff = p[c] - b[c];
+                    if (std::abs(diff) <= threshold) continue;
+                    float v = std::clamp(p[c] + amount * diff, 0.0f, static_cast<float>(a));
+                    p[c] = static_cast<uint8_t>(v + 0.5f);
+                }
+            }
+        }
+    }
+
+    SharpenPreset PresetFor(PrintMedia media)
+    {
+        switch (media)
+        {
+        case PrintMedia::Glossy: return { 0.085, 0.60, 2 };   // ≈1 px at 300 DPI, gloss shows detail
+        case PrintMedia::Matte:  return { 0.127, 1.00, 3 };   // matte diffuses, needs more
+        case PrintMedia::DyeSub: return { 0.100, 0.80, 2 };   // dye diffusion softens edges slightly
+        default:                 return { 0.0, 0.0, 0 };
+        }
+    }
+
+    void UnsharpMask(PixelBuffer& image, double sigmaPx, double amount, int threshold)
+    {
+        if (image.Empty() || sigmaPx <= 0.05 || amount <= 0.0) return;
+
+        const int W = image.width, H = image.height;
+        const size_t rowFloats = static_cast<size_t>(W) * 4;
+        int r = 0;
+        auto kernel = GaussianKernel(sigmaPx, r);
+        const int window = 2 * r + 1;
+        const float amt = static_cast<float>(amount);
+        const float thr = static_cast<float>(threshold);
+
+        // Bands read a copy: neighbouring bands read rows this one writes.
+        const PixelBuffer source = image;
+
+        // Each band keeps only the 2r+1 horizontally blurred rows the
+        // vertical pass needs, in a ring, so the working set stays in cache
+        // instead of a full-image float copy. Bands recompute r rows at each
+        // edge.
+        ParallelFor(H, 32, [&](int y0, int y1) {
+            std::vector<float> padded((static_cast<size_t>(W) + 2 * r) * 4);
+            std::vector<float> ring(rowFloats * window);
+            std::vector<float> blur(rowFloats);
+            std::vector<const float*> taps(window);
+
+            // Horizontal pass of source row clamp(yy) into its ring slot;
+            // each pixel is one 4-float vector (B,G,R,A), so a tap is a
+            // single multiply-add across all channels.
+            std::vector<const float*> hTaps(window);
+            for (int k = 0; k < window; ++k) hTaps[k] = &padded[static_cast<size_t>(k) * 4];
+            auto horizontal = [&](int yy) {
+                ToFloat(padded.data(), source.Row(std::clamp(yy, 0, H - 1)), W, r);
+                Convolve(&ring[rowFloats * ((yy - y0 + window) % window)], hTaps.data(), kernel.data(), r, rowFloats);
+            };
+
+            for (int yy = y0 - r; yy < y0 + r; ++yy) horizontal(yy);
+            for (int y = y0; y < y1; ++y)
+            {
+                horizontal(y + r);
+                for (int k = -r; k <= r; ++k)
+                    taps[k + r] = &ring[rowFloats * ((y + k - y0 + 2 * window) % window)];
+                Convolve(blur.data(), taps.data(), kernel.data(), r, rowFloats);
+                BlendRow(image.Row(y), blur.data(), W, amt, thr);
+            }
+            });
+    }
+
+    void SharpenForPrint(PixelBuffer& image, PrintMedia media, double dpi)
+    {
+        auto preset = PresetFor(media);
+        if (preset.amount <= 0.0 || dpi <= 0.0) return;
+        UnsharpMask(image, preset.radiusMm * dpi / 25.4, preset.amount, preset.threshold);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Output sharpening for the printed stamp.
+//
+// Separable Gaussian unsharp mask; the radius is specified physically
+// (millimetres on paper) and converted with the output DPI, so the same
+// preset gives the same visual result at 300 or 600 DPI.
+
+#include "PixelBuffer.h"
+
+namespace PassportTool::Core
+{
+    enum class PrintMedia
+    {
+        None,
+        Glossy,
+        Matte,
+        DyeSub,
+    };
+
+    struct SharpenPreset
+    {
+        double radiusMm;   // Gaussian sigma on paper
+        double amount;     // 1.0 = add 100 % of the high-pass detail
+        int threshold;     // ignore differences at or below this (noise guard)
+    };
+
+    SharpenPreset PresetFor(PrintMedia media);
+
+    // In place on premultiplied BGRA; alpha is left untouched.
+    void UnsharpMask(PixelBuffer& image, double sigmaPx, double amount, int threshold);
+
+    void SharpenForPrint(PixelBuffer& image, PrintMedia media, double dpi);
+}
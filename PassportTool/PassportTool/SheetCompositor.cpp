@@ -0,0 +1,112 @@
+#include "SheetCompositor.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        // Copies src into the w x h cell at (x0, y0). Layout cells are whole
+        // pixels and the stamp is captured at the cell size, so this is a row
+        // memcpy; a mismatched stamp falls back to nearest-neighbour.
+        void Blit(PixelBuffer& dst, int x0, int y0, int w, int h, const PixelBuffer& src)
+        {
+            int cx0 = std::max(0, x0), cy0 = std::max(0, y0);
+            int cx1 = std::min(dst.width, x0 + w), cy1 = std::min(dst.height, y0 + h);
+            if (cx1 <= cx0 || cy1 <= cy0 || src.Empty()) return;
+
+            if (src.width == w && src.height == h)
+            {
+                size_t bytes = static_cast<size_t>(cx1 - cx0) * 4;
+                for (int y = cy0; y < cy1; ++y)
+                    std::memcpy(dst.Row(y) + cx0 * 4, src.Row(y - y0) + (cx0 - x0) * 4, bytes);
+                return;
+            }
+
+            for (int y = cy0; y < cy1; ++y)
+            {
+                int sy = std::min(src.height - 1, static_cast<int>((y - y0 + 0.5) * src.height / h));
+                const uint32_t* srow = reinterpret_cast<const uint32_t*>(src.Row(sy));
+                uint32_t* drow = reinterpret_cast<uint32_t*>(dst.Row(y));
+                for (int x = cx0; x < cx1; ++x)
+                {
+                    int sx = std::min(src.width - 1, static_cast<int>((x - x0 + 0.5) * src.width / w));
+                    drow[x] = srow[sx];
+                }
+            }
+        }
+    }
+
+    PixelBuffer ComposeSheet(int sheetW, int sheetH, const std::vector<ImagePlacement>& placements,
+        const PixelBuffer& stamp, const PixelBuffer& rotatedStamp)
+    {
+        if (sheetW <= 0 || sheetH <= 0) return {};
+        PixelBuffer sheet(sheetW, sheetH);
+        std::fill(sheet.data.begin(), sheet.data.end(), uint8_t(255));
+
+        // Cells never overlap, so placements can be filled independently.
+        ParallelFor(static_cast<int>(placements.size()), 16, [&](int b, int e) {
+            for (int i = b; i < e; ++i)
+            {
+                const auto& p = placements[i];
+                Blit(sheet, p.x, p.y, p.w, p.h, p.rotated ? rotatedStamp : stamp);
+            }
+            });
+        return sheet;
+    }
+
+    PixelBuffer ComposeSheet(const LayoutResult& layout, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp)
+    {
+        return ComposeSheet(layout.metrics.sheetW, layout.metrics.sheetH, layout.placements, stamp, rotatedStamp);
+    }
+
+    PlacementIndex::PlacementIndex(std::vector<ImagePlacement> placements)
+        : m_sorted(std::move(placements))
+    {
+        std::stable_sort(m_sorted.begin(), m_sorted.end(),
+            [](const ImagePlacement& a, const ImagePlacement& b) { return a.y < b.y; });
+        for (const auto& p : m_sorted) m_maxHeight = std::max(m_maxHeight, p.h);
+    }
+
+    void PlacementIndex::InRows(int y0, int y1, const ImagePlacement** first, const ImagePlacement** last) const
+    {
+        // No placement starting at or above y0 - m_maxHeight reaches row y0.
+        auto byTop = [](const ImagePlacement& p, int y) { return p.y < y; };
+        int64_t reach = static_cast<int64_t>(y0) - m_maxHeight + 1;
+        int from = static_cast<int>(std::max<int64_t>(reach, INT_MIN));
+        auto lo = std::lower_bound(m_sorted.begin(), m_sorted.end(), from, byTop);
+        auto hi = std::lower_bound(lo, m_sorted.end(), y1, byTop);
+        *first = m_sorted.data() + (lo - m_sorted.begin());
+        *last = m_sorted.data() + (hi - m_sorted.begin());
+    }
+
+    void ComposeBand(const PlacementIndex& index, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp,
+        int y0, PixelBuffer& band)
+    {
+        std::fill(band.data.begin(), band.data.end(), uint8_t(255));
+        int y1 = y0 + band.height;
+        const ImagePlacement* first;
+        const ImagePlacement* last;
+        index.InRows(y0, y1, &first, &last);
+        for (const ImagePlacement* p = first; p != last; ++p)
+        {
+            if (p->y + p->h <= y0) continue;
+            Blit(band, p->x, p->y - y0, p->w, p->h, p->rotated ? rotatedStamp : stamp);
+        }
+    }
+
+    void ComposeBand(const std::vector<ImagePlacement>& placements, const PixelBuffer& stamp,
+        const PixelBuffer& rotatedStamp, int y0, PixelBuffer& band)
+    {
+        std::fill(band.data.begin(), band.data.end(), uint8_t(255));
+        int y1 = y0 + band.height;
+        for (const auto& p : placements)
+        {
+            if (p.y >= y1 || p.y + p.h <= y0) continue;
+            Blit(band, p.x, p.y - y0, p.w, p.h, p.rotated ? rotatedStamp : stamp);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// CPU composition of the print sheet from a layout and the stamp pair.
+
+#include "Layout.h"
+#include "PixelBuffer.h"
+#include <vector>
+
+namespace PassportTool::Core
+{
+    // White sheet of sheetW x sheetH pixels with every placement filled from
+    // stamp (upright) or rotatedStamp. A stamp whose size differs from the
+    // cell is resampled; matching sizes are copied row by row.
+    PixelBuffer ComposeSheet(int sheetW, int sheetH, const std::vector<ImagePlacement>& placements,
+        const PixelBuffer& stamp, const PixelBuffer& rotatedStamp);
+
+    // Same, sized from the layout's sheet metrics.
+    PixelBuffer ComposeSheet(const LayoutResult& layout, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp);
+
+    // A sheet's placements ordered by top edge, so each band of a streamed
+    // sheet finds the few it overlaps by binary search: streaming costs
+    // O(bands * log placements) on top of the pixels, not bands * placements.
+    class PlacementIndex
+    {
+    public:
+        explicit PlacementIndex(std::vector<ImagePlacement> placements);
+
+        // Candidates for rows [y0, y1): every placement overlapping them is
+        // in [first, last), along with a few that end above y0.
+        void InRows(int y0, int y1, const ImagePlacement** first, const ImagePlacement** last) const;
+
+    private:
+        std::vector<ImagePlacement> m_sorted;   // by y
+        int m_maxHeight{ 0 };
+    };
+
+    // Fills band with sheet rows [y0, y0 + band.height); band must be the
+    // sheet width. Used to stream a sheet without holding all of it.
+    void ComposeBand(const PlacementIndex& index, const PixelBuffer& stamp, const PixelBuffer& rotatedStamp,
+        int y0, PixelBuffer& band);
+
+    // Same, from a placement list that is already cut to the band (e.g.
+    // RollLayout::PlacementsInRows with y0 = 0); every entry is visited.
+    void ComposeBand(const std::vector<ImagePlacement>& placements, const PixelBuffer& stamp,
+        const PixelBuffer& rotatedStamp, int y0, PixelBuffer& band);
+}
@@ -0,0 +1,260 @@
+#include "TaskScheduler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <string>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr int kBackground = static_cast<int>(TaskPriority::Background);
+
+        thread_local TaskScheduler* t_scheduler = nullptr;
+        thread_local int t_index = -1;
+        thread_local TaskPriority t_priority = TaskPriority::Normal;
+    }
+
+    TaskPriority CurrentTaskPriority()
+    {
+        return t_priority;
+    }
+
+    TaskScheduler::TaskScheduler(unsigned workers)
+    {
+        // At least two, so a background job never leaves interactive work
+        // without a worker even on a single core.
+        if (workers == 0) workers = std::max(2u, std::thread::hardware_concurrency());
+        m_backgroundLimit = std::max(1, static_cast<int>(workers) - 1);
+        for (unsigned i = 0; i < workers; ++i) m_queues.push_back(std::make_unique<Queue>());
+        m_workers.reserve(workers);
+        for (unsigned i = 0; i < workers; ++i) m_workers.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        m_stop = true;
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_all();
+        for (auto& w : m_workers) w.join();
+    }
+
+    TaskScheduler& TaskScheduler::Shared()
+    {
+        // Never destroyed: joining at exit could wait on a stuck I/O task.
+        static TaskScheduler* pool = new TaskScheduler();
+        return *pool;
+    }
+
+    void TaskScheduler::Submit(TaskPriority priority, std::function<void()> task)
+    {
+        int p = static_cast<int>(priority);
+        // Work spawned by a worker stays on its own deque; outside work is
+        // spread round-robin and reaches idle workers by stealing.
+        unsigned q = (t_scheduler == this && t_index >= 0)
+            ? static_cast<unsigned>(t_index)
+            : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        {
+            std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+            m_queues[q]->tasks[p].push_back(std::move(task));
+        }
+        m_pending[p].fetch_add(1);
+        Wake();
+    }
+
+    bool TaskScheduler::RunOne(TaskPriority lowest)
+    {
+        std::function<void()> task;
+        int p;
+        int self = (t_scheduler == this) ? t_index : -1;
+        if (!TakeTask(self, static_cast<int>(lowest), false, &task, &p)) return false;
+        Run(task, p, false);
+        return true;
+    }
+
+    void TaskScheduler::ForEach(int count, TaskPriority priority, const std::function<void(int)>& fn)
+    {
+        if (count <= 0) return;
+        if (count == 1)
+        {
+            fn(0);
+            return;
+        }
+
+        struct Join
+        {
+            std::atomic<int> remaining;
+            std::mutex mutex;
+            std::condition_variable done;
+            std::exception_ptr error;
+        };
+        auto join = std::make_shared<Join>();
+        join->remaining = count;
+
+        auto runIndex = [join, &fn](int i) {
+            try { fn(i); }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(join->mutex);
+                if (!join->error) join->error = std::current_exception();
+            }
+            if (join->remaining.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(join->mutex);
+                join->done.notify_all();
+            }
+        };
+
+        for (int i = 1; i < count; ++i) Submit(priority, [runIndex, i]() { runIndex(i); });
+        runIndex(0);
+
+        // Help rather than block; only sleep once every chunk is claimed.
+        // The timeout covers a chunk queued after a helper looked.
+        while (join->remaining.load() > 0)
+        {
+            if (RunOne(priority)) continue;
+            std::unique_lock<std::mutex> lock(join->mutex);
+            join->done.wait_for(lock, std::chrono::microseconds(200), [&]() { return join->remaining.load() == 0; });
+        }
+        if (join->error) std::rethrow_exception(join->error);
+    }
+
+    TaskScheduler::Stats TaskScheduler::GetStats() const
+    {
+        return { m_executed.load(), m_stolen.load() };
+    }
+
+    void TaskScheduler::WorkerLoop(unsigned index)
+    {
+        t_scheduler = this;
+        t_index = static_cast<int>(index);
+        SetTraceThreadName(("worker " + std::to_string(index)).c_str());
+
+        for (;;)
+        {
+            std::function<void()> task;
+            int p;
+            if (TakeTask(static_cast<int>(index), kBackground, true, &task, &p))
+            {
+                Run(task, p, p == kBackground);
+                continue;
+            }
+
+            auto drained = [&]() {
+                return m_pending[0].load() + m_pending[1].load() + m_pending[2].load() <= 0;
+            };
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [&]() { return (m_stop && drained()) || HasRunnable(); });
+            if (m_stop && drained()) break;
+        }
+    }
+
+    // Highest priority first; own deque from the back, then the other
+    // deques from the front. With capBackground a Background task is only
+    // taken while fewer than m_backgroundLimit are running, and the slot
+    // stays reserved until the caller releases it.
+    bool TaskScheduler::TakeTask(int self, int lowest, bool capBackground, std::function<void()>* task, int* priority)
+    {
+        const int n = static_cast<int>(m_queues.size());
+        for (int p = 0; p <= lowest; ++p)
+        {
+            if (m_pending[p].load() <= 0) continue;
+
+            bool reserved = false;
+            if (p == kBackground && capBackground)
+            {
+                int running = m_backgroundRunning.load();
+                do
+                {
+                    if (running >= m_backgroundLimit) return false;
+                } while (!m_backgroundRunning.compare_exchange_weak(running, running + 1));
+                reserved = true;
+            }
+
+            bool found = false;
+            if (self >= 0)
+            {
+                auto& q = *m_queues[self];
+                std::lock_guard<std::mutex> lock(q.mutex);
+                if (!q.tasks[p].empty())
+                {
+                    *task = std::move(q.tasks[p].back());
+                    q.tasks[p].pop_back();
+                    found = true;
+                }
+            }
+            int start = self >= 0 ? self + 1 : 0;
+            for (int k = 0; !found && k < n; ++k)
+            {
+                int victim = (start + k) % n;
+                if (victim == self) continue;
+                auto& q = *m_queues[victim];
+                std::lock_guard<std::mutex> lock(q.mutex);
+                if (!q.tasks[p].empty())
+                {
+                    *task = std::move(q.tasks[p].front());
+                    q.tasks[p].pop_front();
+                    found = true;
+                    if (self >= 0) m_stolen.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            if (found)
+            {
+                m_pending[p].fetch_sub(1);
+                *priority = p;
+                return true;
+            }
+            if (reserved) m_backgroundRunning.fetch_sub(1);
+        }
+        return false;
+    }
+
+    bool TaskScheduler::HasRunnable() const
+    {
+        return m_pending[0].load() > 0 || m_pending[1].load() > 0 ||
+            (m_pending[kBackground].load() > 0 && m_backgroundRunning.load() < m_backgroundLimit);
+    }
+
+    void TaskScheduler::Run(std::function<void()>& task, int priority, bool releaseBackground)
+    {
+        // Restores the caller's priority and hands back the Background slot
+        // however the task ends.
+        struct Scope
+        {
+            TaskScheduler* pool;
+            TaskPriority outer;
+            bool release;
+            ~Scope()
+            {
+                t_priority = outer;
+                pool->m_executed.fetch_add(1, std::memory_order_relaxed);
+                if (release)
+                {
+                    pool->m_backgroundRunning.fetch_sub(1);
+                    pool->Wake();
+                }
+            }
+        } scope{ this, t_priority, releaseBackground };
+        t_priority = static_cast<TaskPriority>(priority);
+
+        // A submitted task has no caller to report to (ForEach catches its
+        // own), so an escaping exception is dropped rather than allowed to
+        // kill the worker or unwind whoever helped run it.
+        try { task(); }
+        catch (...) {}
+    }
+
+    void TaskScheduler::Wake()
+    {
+        // Taking the lock orders this against a worker between its
+        // predicate check and its wait, so the notification is not lost.
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_one();
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// Work-stealing task pool for all pixel work.
+//
+// Each worker owns a deque per priority: it pushes and pops its own work at
+// the back (LIFO, cache-warm) and steals from the front of other workers'
+// deques when it runs dry. Tasks never preempt each other once running, so
+// priority works at task boundaries: every worker looks for Interactive work
+// before Normal before Background, and Background tasks may occupy at most
+// WorkerCount() - 1 workers so one is always free for interactive preview.
+// ParallelFor splits stages into chunks that inherit the caller's priority,
+// which keeps long background jobs (pyramid building) yielding between chunks.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    enum class TaskPriority
+    {
+        Interactive,    // the user is waiting on it: capture, rotate, preview
+        Normal,         // explicit but not latency-critical: save, print
+        Background,     // speculative: cache writes, pyramids
+    };
+
+    constexpr int kTaskPriorityCount = 3;
+
+    // Priority of the task running on this thread; Normal outside the pool.
+    TaskPriority CurrentTaskPriority();
+
+    class TaskScheduler
+    {
+    public:
+        // workers = 0 uses hardware_concurrency (at least 2).
+        explicit TaskScheduler(unsigned workers = 0);
+        ~TaskScheduler();       // runs what is queued, then joins
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+        // Process-wide pool, created on first use.
+        static TaskScheduler& Shared();
+
+        // An exception escaping a submitted task is dropped; use ForEach to
+        // get it back.
+        void Submit(TaskPriority priority, std::function<void()> task);
+
+        // Runs one queued task at `lowest` priority or more urgent on the
+        // calling thread. False if there was none.
+        bool RunOne(TaskPriority lowest = TaskPriority::Background);
+
+        // Runs fn(0) .. fn(count - 1) across the pool and returns when all
+        // are done; the caller runs fn(0) and helps with queued work while
+        // waiting. The first exception thrown is rethrown here.
+        void ForEach(int count, TaskPriority priority, const std::function<void(int)>& fn);
+
+        unsigned WorkerCount() const { return static_cast<unsigned>(m_workers.size()); }
+
+        struct Stats
+        {
+            uint64_t executed;
+            uint64_t stolen;
+        };
+        Stats GetStats() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks[kTaskPriorityCount];
+        };
+
+        void WorkerLoop(unsigned index);
+        bool TakeTask(int self, int lowest, bool capBackground, std::function<void()>* task, int* priority);
+        bool HasRunnable() const;
+        void Run(std::function<void()>& task, int priority, bool releaseBackground);
+        void Wake();
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::atomic<int> m_pending[kTaskPriorityCount]{};
+        std::atomic<int> m_backgroundRunning{ 0 };
+        int m_backgroundLimit{ 1 };
+        std::atomic<unsigned> m_nextQueue{ 0 };
+        std::atomic<uint64_t> m_executed{ 0 };
+        std::atomic<uint64_t> m_stolen{ 0 };
+        std::atomic<bool> m_stop{ false };
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+    };
+}
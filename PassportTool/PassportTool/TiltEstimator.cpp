@@ -0,0 +1,111 @@
+#include "TiltEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr int kWorkDim = 400;
+        constexpr int kBinsPerDeg = 4;
+        constexpr int kBins = 90 * kBinsPerDeg;      // [-45, 45) in 0.25° steps
+        constexpr int kMinMagnitude = 48;            // Sobel units; ignores sensor noise
+        constexpr double kMaxTilt = 20.0;            // RotationSlider range
+        constexpr double kPi = 3.14159265358979323846;
+    }
+
+    TiltEstimate EstimateTilt(const GrayImage& gray)
+    {
+        TiltEstimate result;
+        const int W = gray.width;
+        const int H = gray.height;
+        if (W < 8 || H < 8) return result;
+
+        std::vector<double> hist(kBins, 0.0);
+        std::vector<int32_t> gx(W), gy(W), mag2(W);
+        const int32_t thresh2 = kMinMagnitude * kMinMagnitude;
+        double total = 0.0;
+
+        for (int y = 1; y < H - 1; ++y)
+        {
+            const uint8_t* a = gray.Row(y - 1);
+            const uint8_t* b = gray.Row(y);
+            const uint8_t* c = gray.Row(y + 1);
+
+            // Straight-line Sobel over the row; no branches so it vectorizes.
+            for (int x = 1; x < W - 1; ++x)
+            {
+                int32_t sx = (a[x + 1] + 2 * b[x + 1] + c[x + 1]) - (a[x - 1] + 2 * b[x - 1] + c[x - 1]);
+                int32_t sy = (c[x - 1] + 2 * c[x] + c[x + 1]) - (a[x - 1] + 2 * a[x] + a[x + 1]);
+                gx[x] = sx;
+                gy[x] = sy;
+                mag2[x] = sx * sx + sy * sy;
+            }
+
+            for (int x = 1; x < W - 1; ++x)
+            {
+                if (mag2[x] < thresh2) continue;
+
+                // Line direction is the gradient rotated by -90°; fold to [-45, 45).
+                double deg = std::atan2(static_cast<double>(gy[x]), static_cast<double>(gx[x])) * 180.0 / kPi - 90.0;
+                deg = std::fmod(deg + 45.0, 90.0);
+                if (deg < 0) deg += 90.0;
+                int bin = std::min(kBins - 1, static_cast<int>(deg * kBinsPerDeg));
+
+                double w = std::sqrt(static_cast<double>(mag2[x]));
+                hist[bin] += w;
+                total += w;
+            }
+        }
+        if (total <= 0.0) return result;
+
+        // Circular smoothing (the folded domain wraps at ±45°).
+        std::vector<double> smooth(kBins);
+        for (int i = 0; i < kBins; ++i)
+        {
+            double s = 0.0;
+            for (int k = -2; k <= 2; ++k)
+                s += hist[(i + k + kBins) % kBins] * (3 - std::abs(k));
+            smooth[i] = s / 9.0;
+        }
+
+        int peak = static_cast<int>(std::max_element(smooth.begin(), smooth.end()) - smooth.begin());
+
+        // Parabolic refinement around the peak bin.
+        double l = smooth[(peak - 1 + kBins) % kBins];
+        double m = smooth[peak];
+        double r = smooth[(peak + 1) % kBins];
+        double denom = l - 2.0 * m + r;
+        double offset = (std::abs(denom) > 1e-12) ? 0.5 * (l - r) / denom : 0.0;
+        double angle = (peak + 0.5 + offset) / kBinsPerDeg - 45.0;
+
+        if (std::abs(angle) > kMaxTilt) return result;
+
+        // Share of edge energy within ±1° of the peak, relative to what a
+        // flat histogram would put there (2/90).
+        double near = 0.0;
+        for (int k = -kBinsPerDeg; k <= kBinsPerDeg; ++k)
+            near += hist[(peak + k + kBins) % kBins];
+        double share = near / total;
+        double flat = (2.0 * kBinsPerDeg + 1.0) / kBins;
+
+        result.angleDeg = angle;
+        result.confidence = std::clamp((share - flat) / (0.35 - flat), 0.0, 1.0);
+        return result;
+    }
+
+    TiltEstimate EstimateTilt(const PixelBuffer& src)
+    {
+        return EstimateTilt(DownscaleToGray(src, kWorkDim));
+    }
+
+    double CombineTilt(const FaceDetection& face, const TiltEstimate& scene)
+    {
+        double wf = face.found ? face.confidence : 0.0;
+        double ws = scene.confidence;
+        if (wf + ws <= 0.0) return 0.0;
+        return (face.tiltDeg * wf + scene.angleDeg * ws) / (wf + ws);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+// Scene straightening estimate for the RotationSlider.
+//
+// Builds a magnitude-weighted histogram of edge orientations (folded
+// modulo 90° so horizontal and vertical structure vote together) on a
+// downscaled luminance copy and reports the dominant deviation from the
+// pixel axes.
+
+#include "PixelBuffer.h"
+#include "FaceDetector.h"
+
+namespace PassportTool::Core
+{
+    struct TiltEstimate
+    {
+        double angleDeg{ 0 };    // clockwise-positive, same sign as FaceDetection::tiltDeg
+        double confidence{ 0 };  // 0..1, how much the peak stands out from a flat histogram
+    };
+
+    TiltEstimate EstimateTilt(const GrayImage& gray);
+    TiltEstimate EstimateTilt(const PixelBuffer& src);
+
+    // Confidence-weighted blend of the eye line and the scene edges.
+    // Either source may be missing (not found / zero confidence).
+    double CombineTilt(const FaceDetection& face, const TiltEstimate& scene);
+}
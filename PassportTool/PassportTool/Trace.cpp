@@ -0,0 +1,375 @@
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace PassportTool::Core
+{
+    namespace
+    {
+        constexpr size_t kLaneCapacity = 8192;     // spans kept per thread
+        constexpr size_t kMaxMessages = 2048;
+        constexpr int kHistogramBuckets = 32;
+
+        struct Event
+        {
+            const char* name;
+            int64_t start;
+            int64_t dur;
+            uint32_t tid;     // lane of the thread that opened the span
+        };
+
+        // Ring slot read while its owner may be overwriting it, so every
+        // field is a relaxed atomic and `index` works as a seqlock: the
+        // writer clears it before touching the fields and stores the event
+        // index after; a reader keeps its copy only if it saw the same index
+        // on both sides of the copy.
+        struct Slot
+        {
+            static constexpr uint64_t kWriting = ~0ull;
+
+            std::atomic<uint64_t> index{ kWriting };
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<int64_t> start{ 0 };
+            std::atomic<int64_t> dur{ 0 };
+            std::atomic<uint32_t> tid{ 0 };
+        };
+
+        // One ring per live thread. Only the owning thread writes; `head` is
+        // published with release so the exporter can read without a lock.
+        // Lanes are recycled when their thread exits, which keeps the
+        // pool's worker threads from growing the registry.
+        struct Lane
+        {
+            uint32_t id{ 0 };
+            bool inUse{ false };          // guarded by Registry::mutex
+            std::string name;             // guarded by Registry::mutex
+            std::atomic<uint64_t> head{ 0 };
+            std::atomic<uint64_t> cleared{ 0 };   // events before this index are hidden
+            std::array<Slot, kLaneCapacity> events;
+        };
+
+        struct Message
+        {
+            int64_t ts;
+            uint32_t tid;
+            std::string text;
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Lane>> lanes;
+            std::deque<Message> messages;
+        };
+
+        Registry& GetRegistry()
+        {
+            // Never destroyed: pool workers may still record at exit.
+            static Registry* registry = new Registry();
+            return *registry;
+        }
+
+        std::atomic<bool> g_enabled{ true };
+
+        struct LaneHandle
+        {
+            Lane* lane{ nullptr };
+            ~LaneHandle()
+            {
+                if (!lane) return;
+                std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+                lane->inUse = false;
+            }
+        };
+
+        Lane& CurrentLane()
+        {
+            thread_local LaneHandle handle;
+            if (handle.lane) return *handle.lane;
+
+            auto& reg = GetRegistry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (auto& l : reg.lanes)
+                if (!l->inUse) { handle.lane = l.get(); break; }
+            if (!handle.lane)
+            {
+                reg.lanes.push_back(std::make_unique<Lane>());
+                handle.lane = reg.lanes.back().get();
+                handle.lane->id = static_cast<uint32_t>(reg.lanes.size());
+            }
+            handle.lane->inUse = true;
+            handle.lane->name.clear();
+            return *handle.lane;
+        }
+
+        void Push(const char* name, int64_t start, int64_t end, uint32_t tid)
+        {
+            Lane& lane = CurrentLane();
+            uint64_t h = lane.head.load(std::memory_order_relaxed);
+            Slot& s = lane.events[h % kLaneCapacity];
+            s.index.store(Slot::kWriting, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s.name.store(name, std::memory_order_relaxed);
+            s.start.store(start, std::memory_order_relaxed);
+            s.dur.store(std::max<int64_t>(0, end - start), std::memory_order_relaxed);
+            s.tid.store(tid, std::memory_order_relaxed);
+            s.index.store(h, std::memory_order_release);
+            lane.head.store(h + 1, std::memory_order_release);
+        }
+
+        // Snapshot of every lane. A writer may lap the reader while it copies;
+        // slots overwritten during the copy fail the index check and are
+        // dropped.
+        std::vector<Event> Collect()
+        {
+            std::vector<Event> out;
+            auto& reg = GetRegistry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (auto& l : reg.lanes)
+            {
+                uint64_t head = l->head.load(std::memory_order_acquire);
+                uint64_t first = head > kLaneCapacity ? head - kLaneCapacity : 0;
+                first = std::max(first, l->cleared.load(std::memory_order_relaxed));
+                for (uint64_t i = first; i < head; ++i)
+                {
+                    const Slot& s = l->events[i % kLaneCapacity];
+                    if (s.index.load(std::memory_order_acquire) != i) continue;
+                    Event e{ s.name.load(std::memory_order_relaxed), s.start.load(std::memory_order_relaxed),
+                        s.dur.load(std::memory_order_relaxed), s.tid.load(std::memory_order_relaxed) };
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (s.index.load(std::memory_order_relaxed) != i) continue;
+                    out.push_back(e);
+                }
+            }
+            return out;
+        }
+
+        void AppendEscaped(std::string& out, const std::string& s)
+        {
+            for (unsigned char c : s)
+            {
+                switch (c)
+                {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20)
+                    {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out += buf;
+                    }
+                    else out += static_cast<char>(c);
+                }
+            }
+        }
+
+        void AppendUs(std::string& out, double us)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.3f", us);
+            out += buf;
+        }
+
+        double Percentile(const std::vector<int64_t>& sorted, double p)
+        {
+            if (sorted.empty()) return 0;
+            size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1] / 1000.0;
+        }
+    }
+
+    int64_t TraceNow()
+    {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    bool TraceEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+    void SetTraceEnabled(bool enabled) { g_enabled.store(enabled, std::memory_order_relaxed); }
+
+    void SetTraceThreadName(const char* name)
+    {
+        Lane& lane = CurrentLane();
+        std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+        lane.name = name ? name : "";
+    }
+
+    void TraceRecord(const char* name, int64_t startNs, int64_t endNs)
+    {
+        if (!TraceEnabled()) return;
+        Push(name, startNs, endNs, CurrentLane().id);
+    }
+
+    void TraceMessage(const std::string& text)
+    {
+        if (!TraceEnabled()) return;
+        int64_t ts = TraceNow();
+        uint32_t tid = CurrentLane().id;
+        auto& reg = GetRegistry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.messages.push_back({ ts, tid, text });
+        if (reg.messages.size() > kMaxMessages) reg.messages.pop_front();
+    }
+
+    TraceSpan::TraceSpan(const char* name)
+        : m_name(name), m_start(-1), m_lane(0)
+    {
+        if (!TraceEnabled()) return;
+        m_lane = CurrentLane().id;
+        m_start = TraceNow();
+    }
+
+    void TraceSpan::End()
+    {
+        if (m_start < 0) return;
+        Push(m_name, m_start, TraceNow(), m_lane);
+        m_start = -1;
+    }
+
+    std::vector<StageSummary> SummarizeTrace()
+    {
+        std::map<std::string, std::vector<int64_t>> byName;
+        for (const auto& e : Collect()) byName[e.name].push_back(e.dur);
+
+        std::vector<StageSummary> out;
+        out.reserve(byName.size());
+        for (auto& [name, durs] : byName)
+        {
+            std::sort(durs.begin(), durs.end());
+            StageSummary s;
+            s.name = name;
+            s.count = durs.size();
+            s.histogram.assign(kHistogramBuckets, 0);
+            for (int64_t d : durs)
+            {
+                s.totalUs += d / 1000.0;
+                int64_t us = d / 1000;
+                int bucket = 0;
+                while (us > 0 && bucket < kHistogramBuckets - 1) { us >>= 1; ++bucket; }
+                ++s.histogram[bucket];
+            }
+            s.minUs = durs.front() / 1000.0;
+            s.maxUs = durs.back() / 1000.0;
+            s.p50Us = Percentile(durs, 0.50);
+            s.p90Us = Percentile(durs, 0.90);
+            s.p99Us = Percentile(durs, 0.99);
+            // Drop the empty tail so the JSON stays short.
+            while (!s.histogram.empty() && s.histogram.back() == 0) s.histogram.pop_back();
+            out.push_back(std::move(s));
+        }
+        std::sort(out.begin(), out.end(),
+            [](const StageSummary& a, const StageSummary& b) { return a.totalUs > b.totalUs; });
+        return out;
+    }
+
+    std::string ExportChromeTrace()
+    {
+        auto events = Collect();
+        std::sort(events.begin(), events.end(),
+            [](const Event& a, const Event& b) { return a.start < b.start; });
+
+        std::string out;
+        out.reserve(events.size() * 96 + 4096);
+        out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        auto sep = [&] { if (!first) out += ",\n"; else out += "\n"; first = false; };
+
+        for (const auto& e : events)
+        {
+            sep();
+            out += "{\"name\":\"";
+            AppendEscaped(out, e.name);
+            out += "\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(e.tid) + ",\"ts\":";
+            AppendUs(out, e.start / 1000.0);
+            out += ",\"dur\":";
+            AppendUs(out, e.dur / 1000.0);
+            out += "}";
+        }
+
+        {
+            auto& reg = GetRegistry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (const auto& m : reg.messages)
+            {
+                sep();
+                out += "{\"name\":\"";
+                AppendEscaped(out, m.text);
+                out += "\",\"cat\":\"log\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" + std::to_string(m.tid) + ",\"ts\":";
+                AppendUs(out, m.ts / 1000.0);
+                out += "}";
+            }
+            for (const auto& l : reg.lanes)
+            {
+                sep();
+                out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(l->id) +
+                    ",\"args\":{\"name\":\"";
+                AppendEscaped(out, l->name.empty() ? "worker " + std::to_string(l->id) : l->name);
+                out += "\"}}";
+            }
+        }
+
+        out += "\n],\"otherData\":{\"summary\":{";
+        bool firstStage = true;
+        for (const auto& s : SummarizeTrace())
+        {
+            if (!firstStage) out += ",";
+            firstStage = false;
+            out += "\n\"";
+            AppendEscaped(out, s.name);
+            out += "\":{\"count\":" + std::to_string(s.count) + ",\"total_us\":";
+            AppendUs(out, s.totalUs);
+            out += ",\"min_us\":"; AppendUs(out, s.minUs);
+            out += ",\"p50_us\":"; AppendUs(out, s.p50Us);
+            out += ",\"p90_us\":"; AppendUs(out, s.p90Us);
+            out += ",\"p99_us\":"; AppendUs(out, s.p99Us);
+            out += ",\"max_us\":"; AppendUs(out, s.maxUs);
+            out += ",\"log2_us_histogram\":[";
+            for (size_t i = 0; i < s.histogram.size(); ++i)
+            {
+                if (i) out += ",";
+                out += std::to_string(s.histogram[i]);
+            }
+            out += "]}";
+        }
+        out += "\n}}}\n";
+        return out;
+    }
+
+    std::string FormatTraceSummary()
+    {
+        std::string out = "stage                        count   total ms    p50 ms    p90 ms    max ms\n";
+        char line[160];
+        for (const auto& s : SummarizeTrace())
+        {
+            std::snprintf(line, sizeof(line), "%-28s %5zu %10.2f %9.2f %9.2f %9.2f\n",
+                s.name.c_str(), s.count, s.totalUs / 1000.0, s.p50Us / 1000.0,
+                s.p90Us / 1000.0, s.maxUs / 1000.0);
+            out += line;
+        }
+        return out;
+    }
+
+    void ClearTrace()
+    {
+        auto& reg = GetRegistry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        // Writers never take the mutex, so rather than resetting their rings
+        // the read window is moved past everything recorded so far.
+        for (auto& l : reg.lanes)
+            l->cleared.store(l->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        reg.messages.clear();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Stage-level tracing that stays on in release builds.
+// Spans are recorded into per-thread ring buffers without taking a lock;
+// the only shared state touched on the hot path is the enabled flag. The
+// buffers are exported on demand as Chrome trace JSON (chrome://tracing,
+// Perfetto) together with a per-stage duration summary.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PassportTool::Core
+{
+    // Monotonic nanoseconds since the first call in this process.
+    int64_t TraceNow();
+
+    bool TraceEnabled();
+    void SetTraceEnabled(bool enabled);
+
+    // Labels the calling thread in the exported trace (e.g. "UI").
+    void SetTraceThreadName(const char* name);
+
+    // Records a completed span. `name` is stored by pointer, so it must
+    // outlive the trace (use string literals).
+    void TraceRecord(const char* name, int64_t startNs, int64_t endNs);
+
+    // Instant event carrying free text (log lines). Copies the text and takes
+    // a mutex, so it is meant for diagnostics, not per-pixel work.
+    void TraceMessage(const std::string& text);
+
+    // RAII span: measures from construction to End() or destruction. Spans
+    // may end on a different thread than they began (coroutines that hop to
+    // the background); they are attributed to the thread that opened them.
+    class TraceSpan
+    {
+    public:
+        explicit TraceSpan(const char* name);
+        ~TraceSpan() { End(); }
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        void End();
+
+    private:
+        const char* m_name;
+        int64_t m_start;
+        uint32_t m_lane;
+    };
+
+    struct StageSummary
+    {
+        std::string name;
+        size_t count{ 0 };
+        double totalUs{ 0 };
+        double minUs{ 0 };
+        double p50Us{ 0 };
+        double p90Us{ 0 };
+        double p99Us{ 0 };
+        double maxUs{ 0 };
+        // histogram[i] counts spans with duration in [2^(i-1), 2^i) µs;
+        // bucket 0 is everything under 1 µs.
+        std::vector<uint32_t> histogram;
+    };
+
+    // Per-stage statistics over the spans currently held in the buffers,
+    // sorted by total time descending.
+    std::vector<StageSummary> SummarizeTrace();
+
+    // {"traceEvents":[...], "otherData":{"summary":{...}}} in the Chrome
+    // trace event format. Timestamps are microseconds.
+    std::string ExportChromeTrace();
+
+    // Plain-text summary table for the log.
+    std::string FormatTraceSummary();
+
+    // Drops all recorded spans and messages.
+    void ClearTrace();
+}
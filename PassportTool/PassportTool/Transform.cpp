@@ -0,0 +1,87 @@
+#include "Transform.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace PassportTool::Core
+{
+    PixelBuffer Rotate90(const PixelBuffer& src)
+    {
+        if (src.Empty()) return {};
+        const int W = src.width, H = src.height;
+        PixelBuffer dst(H, W);
+
+        // 32x32 tiles keep both the row reads and the column writes in cache.
+        constexpr int kTile = 32;
+        const uint32_t* s = reinterpret_cast<const uint32_t*>(src.data.data());
+        uint32_t* d = reinterpret_cast<uint32_t*>(dst.data.data());
+        for (int ty = 0; ty < H; ty += kTile)
+        {
+            int yEnd = std::min(H, ty + kTile);
+            for (int tx = 0; tx < W; tx += kTile)
+            {
+                int xEnd = std::min(W, tx + kTile);
+                for (int y = ty; y < yEnd; ++y)
+                {
+                    const uint32_t* row = s + static_cast<size_t>(y) * W;
+                    int dx = H - 1 - y;
+                    for (int x = tx; x < xEnd; ++x)
+                        d[static_cast<size_t>(x) * H + dx] = row[x];
+                }
+            }
+        }
+        return dst;
+    }
+
+    PixelBuffer ResampleCrop(const PixelBuffer& src, const CropTransform& crop, int outW, int outH)
+    {
+        if (src.Empty() || outW <= 0 || outH <= 0 || crop.zoom <= 0 ||
+            crop.viewportW <= 0 || crop.viewportH <= 0) return {};
+
+        PixelBuffer dst(outW, outH);
+        const double sx = crop.viewportW / outW / crop.zoom;
+        const double sy = crop.viewportH / outH / crop.zoom;
+        const double cx = src.width * 0.5, cy = src.height * 0.5;
+        const double th = -crop.angleDeg * 3.14159265358979323846 / 180.0;   // inverse rotation
+        const double ct = std::cos(th), st = std::sin(th);
+        const int W = src.width, H = src.height;
+
+        ParallelFor(outH, 32, [&](int y0, int y1) {
+            for (int v = y0; v < y1; ++v)
+            {
+                uint8_t* out = dst.Row(v);
+                double py = (crop.offsetY / crop.zoom) + (v + 0.5) * sy - cy;
+                for (int u = 0; u < outW; ++u)
+                {
+                    double px = (crop.offsetX / crop.zoom) + (u + 0.5) * sx - cx;
+                    double fx = cx + px * ct - py * st - 0.5;
+                    double fy = cy + px * st + py * ct - 0.5;
+
+                    uint8_t* o = out + u * 4;
+                    if (fx < -0.5 || fy < -0.5 || fx > W - 0.5 || fy > H - 0.5)
+                    {
+                        o[0] = o[1] = o[2] = o[3] = 255;
+                        continue;
+                    }
+
+                    int x0 = static_cast<int>(std::floor(fx)), y0i = static_cast<int>(std::floor(fy));
+                    double ax = fx - x0, ay = fy - y0i;
+                    int xa = std::clamp(x0, 0, W - 1), xb = std::clamp(x0 + 1, 0, W - 1);
+                    int ya = std::clamp(y0i, 0, H - 1), yb = std::clamp(y0i + 1, 0, H - 1);
+                    const uint8_t* p00 = src.Row(ya) + xa * 4;
+                    const uint8_t* p10 = src.Row(ya) + xb * 4;
+                    const uint8_t* p01 = src.Row(yb) + xa * 4;
+                    const uint8_t* p11 = src.Row(yb) + xb * 4;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        double top = p00[c] + (p10[c] - p00[c]) * ax;
+                        double bot = p01[c] + (p11[c] - p01[c]) * ax;
+                        o[c] = static_cast<uint8_t>(top + (bot - top) * ay + 0.5);
+                    }
+                }
+            }
+            });
+        return dst;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Geometric pixel operations: quarter-turn rotation and the rotated,
+// zoomed crop that CropScrollViewer shows.
+
+#include "PixelBuffer.h"
+
+namespace PassportTool::Core
+{
+    // State of the crop viewport: ScrollViewer zoom/offsets (DIPs), the
+    // RotateTransform angle around the image centre, and the viewport size.
+    struct CropTransform
+    {
+        double zoom{ 1 };
+        double offsetX{ 0 };
+        double offsetY{ 0 };
+        double angleDeg{ 0 };
+        double viewportW{ 0 };
+        double viewportH{ 0 };
+    };
+
+    // Clockwise quarter turn.
+    PixelBuffer Rotate90(const PixelBuffer& src);
+
+    // Bilinear resample of the viewport into an outW x outH stamp; areas
+    // outside the source come out white, like the crop container background.
+    // The app captures through RenderTargetBitmap instead; this is the
+    // portable equivalent the benchmarks measure.
+    PixelBuffer ResampleCrop(const PixelBuffer& src, const CropTransform& crop, int outW, int outH);
+}
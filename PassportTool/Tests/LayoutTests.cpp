@@ -0,0 +1,213 @@
+// Integer sheet layout: agreement with the floating-point layout it
+// replaced, the rounding policy, and that placements stay on the sheet
+// without overlapping.
+
+#include "Layout.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace PassportTool::Core;
+
+namespace
+{
+    int g_failures = 0;
+
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+    struct OldPlacement
+    {
+        double x, y, w, h;
+        bool rotated;
+    };
+
+    // The floating-point layout from before the switch to device pixels,
+    // kept verbatim in behaviour as the reference.
+    std::vector<OldPlacement> OldLayout(double sheetW, double sheetH, double imgW, double imgH, double gap, double ppu)
+    {
+        double g = gap * ppu;
+        double sW = sheetW * ppu, sH = sheetH * ppu;
+        double cW_n = imgW * ppu, cH_n = imgH * ppu;
+        double cW_r = imgH * ppu, cH_r = imgW * ppu;
+
+        auto fit = [g](double D, double s) -> int {
+            if (s <= 0 || D < s + 2.0 * g) return 0;
+            return static_cast<int>(std::floor((D - g) / (s + g)));
+        };
+        auto grid = [&](double aW, double aH, double cW, double cH) -> int64_t {
+            int cols = fit(aW, cW), rows = fit(aH, cH);
+            return (cols <= 0 || rows <= 0) ? 0 : static_cast<int64_t>(rows) * cols;
+        };
+        auto build = [&](std::vector<OldPlacement>& out, double ox, double oy, double aW, double aH,
+            double cW, double cH, bool rot) {
+            int cols = fit(aW, cW), rows = fit(aH, cH);
+            if (cols <= 0 || rows <= 0) return;
+            for (int r = 0; r < rows; ++r)
+                for (int c = 0; c < cols; ++c)
+                    out.push_back({ ox + g + c * (cW + g), oy + g + r * (cH + g), cW, cH, rot });
+        };
+
+        int64_t best = 0;
+        LayoutKind kind = LayoutKind::None;
+        int split = 0;
+        auto consider = [&](int64_t n, LayoutKind k, int s) {
+            if (n > best) { best = n; kind = k; split = s; }
+        };
+        consider(grid(sW, sH, cW_n, cH_n), LayoutKind::Normal, 0);
+        consider(grid(sW, sH, cW_r, cH_r), LayoutKind::Rotated, 0);
+        if (std::abs(imgW - imgH) >= 0.001)
+        {
+            for (int nR = 0, maxNR = fit(sH, cH_n); nR <= maxNR; ++nR)
+            {
+                double sy = nR * (cH_n + g);
+                consider(grid(sW, sy, cW_n, cH_n) + grid(sW, sH - sy, cW_r, cH_r), LayoutKind::MixH, nR);
+            }
+            for (int nC = 0, maxNC = fit(sW, cW_n); nC <= maxNC; ++nC)
+            {
+                double sx = nC * (cW_n + g);
+                consider(grid(sx, sH, cW_n, cH_n) + grid(sW - sx, sH, cW_r, cH_r), LayoutKind::MixV, nC);
+            }
+        }
+
+        std::vector<OldPlacement> out;
+        switch (kind)
+        {
+        case LayoutKind::Normal: build(out, 0, 0, sW, sH, cW_n, cH_n, false); break;
+        case LayoutKind::Rotated: build(out, 0, 0, sW, sH, cW_r, cH_r, true); break;
+        case LayoutKind::MixH: {
+            double sy = split * (cH_n + g);
+            build(out, 0, 0, sW, sy, cW_n, cH_n, false);
+            build(out, 0, sy, sW, sH - sy, cW_r, cH_r, true);
+            break;
+        }
+        case LayoutKind::MixV: {
+            double sx = split * (cW_n + g);
+            build(out, 0, 0, sx, sH, cW_n, cH_n, false);
+            build(out, sx, 0, sW - sx, sH, cW_r, cH_r, true);
+            break;
+        }
+        default: break;
+        }
+        return out;
+    }
+
+    bool Overlap(const ImagePlacement& a, const ImagePlacement& b)
+    {
+        return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+    }
+
+    // With every size a whole number of pixels, and exact in binary, there
+    // is nothing to round, so the integer layout must reproduce the old
+    // one exactly. (With sizes like 10.2 in at 100 ppu the old layout saw
+    // 1019.999... px and could lose a stamp at the margin; that is the
+    // drift the integer layout removes.)
+    void MatchesOldLayout()
+    {
+        std::mt19937 rng(34);
+        std::uniform_int_distribution<int> sheet(100, 1500), stamp(20, 400), gap(0, 20);
+        int compared = 0;
+        for (int i = 0; i < 2000; ++i)
+        {
+            double sw = sheet(rng), sh = sheet(rng), iw = stamp(rng), ih = stamp(rng), g = gap(rng);
+            auto old = OldLayout(sw, sh, iw, ih, g, 1);
+            auto now = CalculateOptimalPlacement(sw, sh, iw, ih, g, 1);
+
+            bool same = old.size() == now.placements.size();
+            for (size_t k = 0; same && k < old.size(); ++k)
+            {
+                const auto& o = old[k];
+                const auto& n = now.placements[k];
+                same = o.x == n.x && o.y == n.y && o.w == n.w && o.h == n.h && o.rotated == n.rotated;
+            }
+            CHECK(same);
+            compared += !old.empty();
+        }
+        CHECK(compared > 1000);
+    }
+
+    // Arbitrary sizes: cells are the rounded stamp size, the sheet rounds
+    // down, and no placement leaves the sheet or overlaps another. Stamp
+    // counts stay within one row or column of the old layout.
+    void RoundingPolicy()
+    {
+        std::mt19937 rng(341);
+        std::uniform_real_distribution<double> sheet(1.0, 12.0), stamp(0.3, 3.0), gap(0.0, 0.2), ppu(72.0, 600.0);
+        for (int i = 0; i < 500; ++i)
+        {
+            double sw = sheet(rng), sh = sheet(rng), iw = stamp(rng), ih = stamp(rng), g = gap(rng), p = ppu(rng);
+            auto r = CalculateOptimalPlacement(sw, sh, iw, ih, g, p);
+            const auto& m = r.metrics;
+            CHECK(m.sheetW == static_cast<int>(std::floor(sw * p + 1e-9)));
+            CHECK(m.sheetH == static_cast<int>(std::floor(sh * p + 1e-9)));
+            CHECK(std::abs(m.cellW - iw * p) <= 0.5 + 1e-6);
+            CHECK(std::abs(m.cellH - ih * p) <= 0.5 + 1e-6);
+
+            bool inside = true, sized = true, apart = true;
+            for (size_t a = 0; a < r.placements.size(); ++a)
+            {
+                const auto& pa = r.placements[a];
+                inside = inside && pa.x >= 0 && pa.y >= 0 && pa.x + pa.w <= m.sheetW && pa.y + pa.h <= m.sheetH;
+                sized = sized && (pa.rotated ? (pa.w == m.cellH && pa.h == m.cellW) : (pa.w == m.cellW && pa.h == m.cellH));
+                for (size_t b = a + 1; b < r.placements.size() && apart; ++b) apart = !Overlap(pa, r.placements[b]);
+            }
+            CHECK(inside);
+            CHECK(sized);
+            CHECK(apart);
+
+            auto again = CalculateOptimalPlacement(sw, sh, iw, ih, g, p);
+            bool deterministic = again.placements.size() == r.placements.size();
+            for (size_t k = 0; deterministic && k < r.placements.size(); ++k)
+                deterministic = again.placements[k].x == r.placements[k].x && again.placements[k].y == r.placements[k].y;
+            CHECK(deterministic);
+
+            // Half a pixel of rounding per cell can cost or gain at most a
+            // row or column's worth of stamps.
+            auto old = OldLayout(sw, sh, iw, ih, g, p);
+            int64_t slack = static_cast<int64_t>(std::max(m.sheetW, m.sheetH) / std::max(1, std::min(m.cellW, m.cellH))) + 1;
+            CHECK(std::llabs(static_cast<long long>(old.size()) - static_cast<long long>(r.placements.size())) <= slack);
+        }
+    }
+
+    // Sizes that land a hair under .5 in binary still round the way they read.
+    void Nudge()
+    {
+        CHECK(ToDevicePixels(1.378, 300) == 413);       // 413.4
+        CHECK(ToDevicePixels(0.505, 100) == 51);        // 50.49999...
+        CHECK(ToDevicePixels(2, 300) == 600);
+        CHECK(ToDevicePixels(-1, 300) == 0);
+        CHECK(ToDevicePixels(std::nan(""), 300) == 0);
+
+        // 2x2 in stamps on 6x4 in paper at 300 DPI fill it exactly: 3 x 2.
+        auto r = CalculateOptimalPlacement(6, 4, 2, 2, 0, 300);
+        CHECK(r.kind == LayoutKind::Normal);
+        CHECK(r.placements.size() == 6);
+    }
+}
+
+int main()
+{
+    struct Case { const char* name; void (*fn)(); };
+    const Case cases[] = {
+        { "matches_old_layout", MatchesOldLayout },
+        { "rounding_policy", RoundingPolicy },
+        { "nudge", Nudge },
+    };
+    for (const auto& c : cases)
+    {
+        int before = g_failures;
+        c.fn();
+        std::printf("%-24s %s\n", c.name, g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
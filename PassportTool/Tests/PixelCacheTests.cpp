@@ -0,0 +1,184 @@
+// PixelCache: store/map round trip, LRU eviction under the byte cap,
+// recency rebuilt from file times on restart, and damaged entries.
+//
+// Each case works in its own scratch directory under the system temp
+// folder, removed afterwards.
+
+#include "PixelCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+using namespace PassportTool::Core;
+namespace fs = std::filesystem;
+
+namespace
+{
+    int g_failures = 0;
+
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+    class ScratchDir
+    {
+    public:
+        ScratchDir()
+        {
+            std::random_device rd;
+            m_path = fs::temp_directory_path() / ("pt_cache_test_" + std::to_string(rd()));
+            fs::create_directories(m_path);
+        }
+        ~ScratchDir()
+        {
+            std::error_code ec;
+            fs::remove_all(m_path, ec);
+        }
+        const fs::path& Path() const { return m_path; }
+
+    private:
+        fs::path m_path;
+    };
+
+    PixelBuffer Pixels(int w, int h, uint8_t seed)
+    {
+        PixelBuffer b(w, h);
+        for (size_t i = 0; i < b.data.size(); ++i) b.data[i] = static_cast<uint8_t>(i * 7 + seed);
+        return b;
+    }
+
+    // Entries are named by key: "<16 hex digits>.ptpx".
+    fs::path EntryPath(const fs::path& dir, uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.ptpx", static_cast<unsigned long long>(key));
+        return dir / name;
+    }
+
+    void RoundTrip()
+    {
+        ScratchDir dir;
+        PixelCache cache(dir.Path(), 1 << 20);
+        PixelBuffer px = Pixels(31, 17, 5);
+        CHECK(!cache.Find(42));
+        CHECK(cache.Store(42, px));
+        CHECK(cache.Contains(42));
+        auto hit = cache.Find(42);
+        CHECK(hit != nullptr);
+        if (!hit) return;
+        CHECK(hit->Width() == 31 && hit->Height() == 17);
+        CHECK(std::memcmp(hit->Data(), px.data.data(), px.data.size()) == 0);
+        CHECK(hit->ToPixelBuffer().data == px.data);
+        CHECK(cache.Store(42, px));     // already there: no second copy
+        CHECK(cache.SizeBytes() < 2 * px.data.size());
+    }
+
+    // Room for three entries: storing a fourth evicts the least recently
+    // used one, and a Find counts as a use.
+    void LruEviction()
+    {
+        ScratchDir dir;
+        PixelBuffer px = Pixels(64, 64, 1);
+        uint64_t entry;
+        {
+            PixelCache probe(dir.Path() / "probe", 1 << 30);
+            probe.Store(1, px);
+            entry = probe.SizeBytes();
+        }
+        PixelCache cache(dir.Path() / "cache", entry * 3);
+        CHECK(cache.Store(1, px));
+        CHECK(cache.Store(2, px));
+        CHECK(cache.Store(3, px));
+        CHECK(cache.Find(1) != nullptr);
+        CHECK(cache.Store(4, px));
+        CHECK(cache.Contains(1));
+        CHECK(!cache.Contains(2));
+        CHECK(cache.Contains(3));
+        CHECK(cache.Contains(4));
+        CHECK(cache.SizeBytes() <= cache.Capacity());
+
+        cache.SetCapacity(entry);
+        CHECK(cache.Contains(4));
+        CHECK(!cache.Contains(1) && !cache.Contains(3));
+        CHECK(cache.SizeBytes() == entry);
+    }
+
+    // A new cache on the same directory orders entries by file time, so the
+    // recency from the last session decides what goes first.
+    void Restart()
+    {
+        ScratchDir dir;
+        PixelBuffer px = Pixels(32, 32, 9);
+        uint64_t entry;
+        {
+            PixelCache cache(dir.Path(), 1 << 30);
+            cache.Store(10, px);
+            cache.Store(20, px);
+            cache.Store(30, px);
+            entry = cache.SizeBytes() / 3;
+        }
+        // Oldest first: 20, 30, 10.
+        auto now = fs::file_time_type::clock::now();
+        int age = 3;
+        for (uint64_t key : { 20, 30, 10 })
+        {
+            fs::path path = EntryPath(dir.Path(), key);
+            std::error_code ec;
+            fs::last_write_time(path, now - std::chrono::hours(age--), ec);
+            CHECK(!ec);
+        }
+        // A leftover temp file from an interrupted store is cleaned up.
+        std::ofstream(dir.Path() / "stale.tmp") << "x";
+
+        PixelCache cache(dir.Path(), entry * 2);
+        CHECK(!cache.Contains(20));
+        CHECK(cache.Contains(30));
+        CHECK(cache.Contains(10));
+        CHECK(!fs::exists(dir.Path() / "stale.tmp"));
+    }
+
+    // A truncated entry is a miss and is dropped from the index.
+    void Damaged()
+    {
+        ScratchDir dir;
+        PixelCache cache(dir.Path(), 1 << 20);
+        CHECK(cache.Store(7, Pixels(40, 40, 3)));
+        fs::path path = EntryPath(dir.Path(), 7);
+        CHECK(fs::exists(path));
+        if (!fs::exists(path)) return;
+        fs::resize_file(path, 100);
+        CHECK(cache.Find(7) == nullptr);
+        CHECK(!cache.Contains(7));
+        CHECK(cache.SizeBytes() == 0);
+        CHECK(!fs::exists(path));
+    }
+}
+
+int main()
+{
+    struct Case { const char* name; void (*fn)(); };
+    const Case cases[] = {
+        { "round_trip", RoundTrip },
+        { "lru_eviction", LruEviction },
+        { "restart", Restart },
+        { "damaged", Damaged },
+    };
+    for (const auto& c : cases)
+    {
+        int before = g_failures;
+        c.fn();
+        std::printf("%-24s %s\n", c.name, g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// .ptjob files: serialise/parse round trip and rejection of malformed
+// values, so a hand-edited or damaged job fails cleanly instead of loading
+// the wrong cache entry or undefined values.
+
+#include "Project.h"
+
+#include <cstdio>
+#include <string>
+
+using namespace PassportTool::Core;
+
+namespace
+{
+    int g_failures = 0;
+
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+    ProjectFile Sample()
+    {
+        ProjectFile p;
+        p.sourcePath = "C:\\Photos\\passport.jpg";
+        p.sourceToken = "src-0123456789abcdef";
+        p.sourceHash = 0xfedcba9876543210ull;
+        p.quarterTurns = 3;
+        p.crop = { 1.75, -12.5, 40.125, -3.2, 640, 480 };
+        p.metric = true;
+        p.imageW = 3.5;
+        p.imageH = 4.5;
+        p.sheetW = 15.2;
+        p.sheetH = 10.2;
+        p.gap = 0.1;
+        p.roll = true;
+        p.rollCount = 1000;
+        p.dpi = 600;
+        p.photoSpec = 2;
+        p.whiteBackground = true;
+        p.printMedia = 1;
+        p.printerProfilePath = "C:\\Profiles\\glossy.icc";
+        p.printerProfileToken = "icc-00000000000000ff";
+        p.stampKey = 0x8000000000000001ull;
+        return p;
+    }
+
+    // Replaces the value of `key` in a serialised job.
+    std::string WithValue(std::string text, const std::string& key, const std::string& value)
+    {
+        auto at = text.find("\n" + key + "=");
+        if (at == std::string::npos) return text;
+        at += key.size() + 2;
+        text.replace(at, text.find('\n', at) - at, value);
+        return text;
+    }
+
+    // Every field survives a round trip exactly, doubles included.
+    void RoundTrip()
+    {
+        ProjectFile a = Sample();
+        std::string error;
+        auto b = ParseProject(SerializeProject(a), &error);
+        CHECK(b.has_value());
+        if (!b) return;
+        CHECK(b->sourcePath == a.sourcePath);
+        CHECK(b->sourceToken == a.sourceToken);
+        CHECK(b->sourceHash == a.sourceHash);
+        CHECK(b->quarterTurns == a.quarterTurns);
+        CHECK(b->crop.zoom == a.crop.zoom && b->crop.offsetX == a.crop.offsetX && b->crop.offsetY == a.crop.offsetY);
+        CHECK(b->crop.angleDeg == a.crop.angleDeg && b->crop.viewportW == a.crop.viewportW &&
+            b->crop.viewportH == a.crop.viewportH);
+        CHECK(b->metric == a.metric);
+        CHECK(b->imageW == a.imageW && b->imageH == a.imageH);
+        CHECK(b->sheetW == a.sheetW && b->sheetH == a.sheetH && b->gap == a.gap);
+        CHECK(b->roll == a.roll && b->rollCount == a.rollCount);
+        CHECK(b->dpi == a.dpi);
+        CHECK(b->photoSpec == a.photoSpec && b->whiteBackground == a.whiteBackground && b->printMedia == a.printMedia);
+        CHECK(b->printerProfilePath == a.printerProfilePath && b->printerProfileToken == a.printerProfileToken);
+        CHECK(b->stampKey == a.stampKey);
+        CHECK(SerializeProject(*b) == SerializeProject(a));
+    }
+
+    // Unknown keys, comments and CRLF line ends are tolerated; missing keys
+    // keep their defaults; turns are normalised.
+    void Tolerant()
+    {
+        std::string text =
+            "PassportToolProject 1\r\n"
+            "# saved by hand\r\n"
+            "source.hash=00000000000000aa\r\n"
+            "source.quarterTurns=-1\r\n"
+            "future.option=whatever\r\n";
+        auto p = ParseProject(text);
+        CHECK(p.has_value());
+        if (!p) return;
+        CHECK(p->sourceHash == 0xaa);
+        CHECK(p->quarterTurns == 3);
+        CHECK(p->imageW == 2 && p->sheetW == 6 && p->rollCount == 24);
+    }
+
+    void Rejected()
+    {
+        const std::string good = SerializeProject(Sample());
+        std::string error;
+
+        CHECK(!ParseProject("", &error));
+        CHECK(!ParseProject("SomethingElse 1\n", &error));
+        CHECK(!ParseProject("PassportToolProject 2\nsource.hash=0000000000000001\n", &error));
+        CHECK(!ParseProject("PassportToolProject 1\nunit=cm\n", &error));     // no source
+
+        // Doubles: no nan/inf, no trailing junk.
+        for (const char* v : { "nan", "inf", "-inf", "1.5x", "", " " })
+            CHECK(!ParseProject(WithValue(good, "image.width", v), &error));
+        // Ints: whole numbers in int range only.
+        for (const char* v : { "1e20", "-3000000000", "2.5", "nan" })
+            CHECK(!ParseProject(WithValue(good, "sheet.rollCount", v), &error));
+        // Keys: exactly 16 hex digits, as written.
+        for (const char* v : { "-1", "+0123456789abcdef", " 0123456789abcdef", "0x23456789abcdef",
+            "0123456789abcde", "0123456789abcdef0", "0123456789abcdeg", "" })
+        {
+            CHECK(!ParseProject(WithValue(good, "cache.stamp", v), &error));
+            CHECK(!ParseProject(WithValue(good, "source.hash", v), &error));
+        }
+
+        auto upper = ParseProject(WithValue(good, "cache.stamp", "0123456789ABCDEF"));
+        CHECK(upper && upper->stampKey == 0x0123456789abcdefull);
+    }
+}
+
+int main()
+{
+    struct Case { const char* name; void (*fn)(); };
+    const Case cases[] = {
+        { "round_trip", RoundTrip },
+        { "tolerant", Tolerant },
+        { "rejected", Rejected },
+    };
+    for (const auto& c : cases)
+    {
+        int before = g_failures;
+        c.fn();
+        std::printf("%-24s %s\n", c.name, g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
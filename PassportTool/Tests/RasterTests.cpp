@@ -0,0 +1,429 @@
+// PWG/URF raster output: what the page headers declare against the pixels
+// that were streamed, band-by-band composition against the whole sheet,
+// decode round trips (from memory and over loopback, as the stand-in
+// receiver gets them), damaged streams and the socket sink's timeouts.
+
+#include "Layout.h"
+#include "Raster.h"
+#include "SheetCompositor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using NativeSocket = SOCKET;
+static void CloseSocket(NativeSocket s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using NativeSocket = int;
+static constexpr NativeSocket INVALID_SOCKET = -1;
+static void CloseSocket(NativeSocket s) { ::close(s); }
+#endif
+
+using namespace PassportTool::Core;
+
+namespace
+{
+    int g_failures = 0;
+
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+    class MemorySink : public ByteSink
+    {
+    public:
+        bool Write(const uint8_t* data, size_t size) override
+        {
+            bytes.insert(bytes.end(), data, data + size);
+            return true;
+        }
+
+        std::vector<uint8_t> bytes;
+    };
+
+    class FailingSink : public ByteSink
+    {
+    public:
+        bool Write(const uint8_t*, size_t) override { return false; }
+    };
+
+    // Distinct colour per pixel so a misplaced or converted pixel shows.
+    PixelBuffer Stamp(int w, int h)
+    {
+        PixelBuffer b(w, h);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                uint8_t* px = b.Row(y) + x * 4;
+                px[0] = static_cast<uint8_t>(x * 13);
+                px[1] = static_cast<uint8_t>(y * 29);
+                px[2] = static_cast<uint8_t>(x + y);
+                px[3] = 255;
+            }
+        return b;
+    }
+
+    PixelBuffer Rotate(const PixelBuffer& src)
+    {
+        PixelBuffer dst(src.height, src.width);
+        for (int y = 0; y < src.height; ++y)
+            for (int x = 0; x < src.width; ++x)
+                std::memcpy(dst.Row(x) + (src.height - 1 - y) * 4, src.Row(y) + x * 4, 4);
+        return dst;
+    }
+
+    // True if the page holds stamp (or its rotation) unchanged at every placement.
+    bool PixelsMatch(const RasterPage& page, const LayoutResult& layout, const PixelBuffer& stamp,
+        const PixelBuffer& rotated)
+    {
+        for (const auto& p : layout.placements)
+        {
+            const PixelBuffer& src = p.rotated ? rotated : stamp;
+            for (int y = 0; y < p.h; ++y)
+                for (int x = 0; x < p.w; ++x)
+                {
+                    const uint8_t* s = src.Row(y) + x * 4;
+                    const uint8_t* d = page.rgb.data() + ((static_cast<size_t>(p.y) + y) * page.width + p.x + x) * 3;
+                    if (d[0] != s[2] || d[1] != s[1] || d[2] != s[0]) return false;
+                }
+        }
+        return true;
+    }
+
+    // True if the decoded page is the composed sheet, pixel for pixel.
+    bool SameAsSheet(const RasterPage& page, const PixelBuffer& sheet)
+    {
+        if (page.width != sheet.width || page.height != sheet.height) return false;
+        for (int y = 0; y < sheet.height; ++y)
+        {
+            const uint8_t* s = sheet.Row(y);
+            const uint8_t* d = page.rgb.data() + static_cast<size_t>(y) * page.width * 3;
+            for (int x = 0; x < sheet.width; ++x, s += 4, d += 3)
+                if (d[0] != s[2] || d[1] != s[1] || d[2] != s[0]) return false;
+        }
+        return true;
+    }
+
+    // Stamps converted with a printer profile are declared device RGB so
+    // the printer does not convert them again; plain stamps stay sRGB. The
+    // pixels themselves pass through untouched either way.
+    void ColorSpace()
+    {
+        auto layout = CalculateOptimalPlacement(2, 1.5, 0.4, 0.5, 0.05, 100);
+        PixelBuffer stamp = Stamp(layout.metrics.cellW, layout.metrics.cellH);
+        PixelBuffer rotated = Rotate(stamp);
+        CHECK(!layout.placements.empty());
+
+        for (RasterFormat format : { RasterFormat::Pwg, RasterFormat::Urf })
+            for (RasterColor color : { RasterColor::Srgb, RasterColor::DeviceRgb })
+            {
+                MemorySink sink;
+                CHECK(StreamSheet(layout, stamp, rotated, format, color, 100, sink));
+
+                // The raw header field, as a printer would read it.
+                bool device = color == RasterColor::DeviceRgb;
+                if (format == RasterFormat::Pwg)
+                {
+                    const uint8_t* cs = sink.bytes.data() + 4 + 400;
+                    uint32_t value = (uint32_t(cs[0]) << 24) | (uint32_t(cs[1]) << 16) | (uint32_t(cs[2]) << 8) | cs[3];
+                    CHECK(value == (device ? 1u : 19u));
+                }
+                else
+                {
+                    CHECK(sink.bytes[12 + 1] == (device ? 5 : 1));
+                }
+
+                auto pages = DecodeRaster(sink.bytes.data(), sink.bytes.size());
+                CHECK(pages && pages->size() == 1);
+                if (!pages || pages->empty()) continue;
+                CHECK((*pages)[0].color == color);
+                CHECK(PixelsMatch((*pages)[0], layout, stamp, rotated));
+            }
+    }
+
+    // Bands found through PlacementIndex add up to the whole sheet, for a
+    // mixed layout whose placements are not in top-edge order and whose
+    // stamps straddle band edges.
+    void BandsMatchSheet()
+    {
+        auto layout = CalculateOptimalPlacement(5.5, 3.5, 0.35, 0.59, 0.02, 100);
+        CHECK(layout.kind == LayoutKind::MixH || layout.kind == LayoutKind::MixV);
+        PixelBuffer stamp = Stamp(layout.metrics.cellW, layout.metrics.cellH);
+        PixelBuffer rotated = Rotate(stamp);
+        PixelBuffer sheet = ComposeSheet(layout, stamp, rotated);
+
+        PlacementIndex index(layout.placements);
+        for (int bandRows : { 1, 7, 64, 1000 })
+        {
+            PixelBuffer band(sheet.width, bandRows);
+            bool same = true;
+            for (int y0 = 0; y0 < sheet.height; y0 += bandRows)
+            {
+                ComposeBand(index, stamp, rotated, y0, band);
+                int rows = std::min(bandRows, sheet.height - y0);
+                same = same && std::memcmp(band.data.data(), sheet.Row(y0), rows * sheet.Stride()) == 0;
+            }
+            CHECK(same);
+        }
+    }
+
+    // Streamed sheets decode back to ComposeSheet's pixels in both formats,
+    // for random layouts and band heights.
+    void RoundTrip()
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<double> sheetSide(1.0, 4.0), stampSide(0.2, 1.2), gap(0.0, 0.1);
+        std::uniform_int_distribution<int> bandRows(1, 300);
+        for (int i = 0; i < 24; ++i)
+        {
+            auto layout = CalculateOptimalPlacement(sheetSide(rng), sheetSide(rng), stampSide(rng), stampSide(rng),
+                gap(rng), 100);
+            if (layout.placements.empty()) continue;
+            PixelBuffer stamp = Stamp(layout.metrics.cellW, layout.metrics.cellH);
+            PixelBuffer rotated = Rotate(stamp);
+            PixelBuffer sheet = ComposeSheet(layout, stamp, rotated);
+            RasterFormat format = i % 2 ? RasterFormat::Urf : RasterFormat::Pwg;
+
+            MemorySink sink;
+            CHECK(StreamSheet(layout, stamp, rotated, format, RasterColor::Srgb, 100, sink, bandRows(rng)));
+            auto pages = DecodeRaster(sink.bytes.data(), sink.bytes.size());
+            CHECK(pages && pages->size() == 1);
+            if (!pages || pages->empty()) continue;
+            CHECK((*pages)[0].dpi == 100);
+            CHECK(SameAsSheet((*pages)[0], sheet));
+        }
+    }
+
+    // A roll streams as one page holding every stamp, which decodes to the
+    // same pixels as composing all its placements at once.
+    void RollRoundTrip()
+    {
+        PixelMetrics metrics = ToDevicePixels(2, 0, 0.35, 0.45, 0.03, 100);
+        RollLayout roll(CalculateRollUnit(metrics));
+        CHECK(!roll.Empty());
+        if (roll.Empty()) return;
+        PixelBuffer stamp = Stamp(metrics.cellW, metrics.cellH);
+        PixelBuffer rotated = Rotate(stamp);
+
+        for (uint64_t count : { 1, 7, 50 })
+        {
+            std::vector<ImagePlacement> all;
+            for (uint64_t i = 0; i < count; ++i) all.push_back(roll.At(i));
+            int length = static_cast<int>(roll.LengthFor(count));
+            PixelBuffer sheet = ComposeSheet(metrics.sheetW, length, all, stamp, rotated);
+
+            MemorySink sink;
+            CHECK(StreamRoll(roll, count, stamp, rotated, RasterFormat::Pwg, RasterColor::Srgb, 100, sink, 37));
+            auto pages = DecodeRaster(sink.bytes.data(), sink.bytes.size());
+            CHECK(pages && pages->size() == 1);
+            if (pages && !pages->empty()) CHECK(SameAsSheet((*pages)[0], sheet));
+        }
+    }
+
+    // Damaged streams are rejected without crashing or allocating what a
+    // bogus header asks for, and a failed sink reports nothing written.
+    void Malformed()
+    {
+        auto layout = CalculateOptimalPlacement(2, 1.5, 0.4, 0.5, 0.05, 100);
+        PixelBuffer stamp = Stamp(layout.metrics.cellW, layout.metrics.cellH);
+        PixelBuffer rotated = Rotate(stamp);
+        MemorySink sink;
+        CHECK(StreamSheet(layout, stamp, rotated, RasterFormat::Pwg, RasterColor::Srgb, 100, sink));
+        const auto& good = sink.bytes;
+
+        std::string error;
+        CHECK(!DecodeRaster(good.data(), 3, &error));
+        CHECK(!DecodeRaster(good.data(), 4 + 1000, &error));               // truncated header
+        CHECK(!DecodeRaster(good.data(), good.size() - 1, &error));        // truncated data
+
+        // A header claiming a huge page over a few bytes of data.
+        std::vector<uint8_t> huge(good.begin(), good.begin() + 4 + 1796);
+        for (size_t offset : { size_t(4 + 372), size_t(4 + 376) })
+        {
+            huge[offset] = 0;
+            huge[offset + 1] = 0x0f;
+            huge[offset + 2] = 0xff;
+            huge[offset + 3] = 0xff;
+        }
+        huge.insert(huge.end(), 64, 0);
+        error.clear();
+        CHECK(!DecodeRaster(huge.data(), huge.size(), &error));
+        CHECK(!error.empty());
+
+        // Unknown colour space.
+        std::vector<uint8_t> gray = good;
+        gray[4 + 400 + 3] = 18;     // sGray
+        CHECK(!DecodeRaster(gray.data(), gray.size(), &error));
+
+        FailingSink failing;
+        RasterWriter writer(failing, RasterFormat::Pwg, RasterColor::Srgb, 1);
+        writer.BeginPage(64, 64, 100);
+        CHECK(!writer.EndPage());
+        CHECK(writer.BytesWritten() == 0);
+    }
+
+    // Over loopback, as the stand-in receiver sees a job: every byte the
+    // sink sends arrives and decodes.
+    void SocketRoundTrip()
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+        NativeSocket listener = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(listener != INVALID_SOCKET);
+        if (listener == INVALID_SOCKET) return;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        bool listening = bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            listen(listener, 1) == 0 && getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0;
+        CHECK(listening);
+        if (!listening)
+        {
+            CloseSocket(listener);
+            return;
+        }
+
+        std::vector<uint8_t> received;
+        std::thread receiver([&] {
+            NativeSocket c = accept(listener, nullptr, nullptr);
+            if (c == INVALID_SOCKET) return;
+            char buf[64 * 1024];
+            for (;;)
+            {
+                int n = static_cast<int>(recv(c, buf, sizeof(buf), 0));
+                if (n <= 0) break;
+                received.insert(received.end(), buf, buf + n);
+            }
+            CloseSocket(c);
+            });
+
+        auto layout = CalculateOptimalPlacement(4, 3, 0.6, 0.8, 0.05, 100);
+        PixelBuffer stamp = Stamp(layout.metrics.cellW, layout.metrics.cellH);
+        PixelBuffer rotated = Rotate(stamp);
+        uint64_t sent = 0;
+        {
+            auto sink = SocketSink::Connect("127.0.0.1", ntohs(addr.sin_port));
+            CHECK(sink != nullptr);
+            if (sink)
+            {
+                MemorySink copy;
+                CHECK(StreamSheet(layout, stamp, rotated, RasterFormat::Urf, RasterColor::Srgb, 100, *sink));
+                CHECK(StreamSheet(layout, stamp, rotated, RasterFormat::Urf, RasterColor::Srgb, 100, copy));
+                sent = copy.bytes.size();
+            }
+        }   // closing the sink ends the job
+        receiver.join();
+        CloseSocket(listener);
+
+        CHECK(received.size() == sent);
+        auto pages = DecodeRaster(received.data(), received.size());
+        CHECK(pages && pages->size() == 1);
+        if (pages && !pages->empty()) CHECK(SameAsSheet((*pages)[0], ComposeSheet(layout, stamp, rotated)));
+    }
+
+    // Loopback listener that never accepts, so the kernel completes the
+    // handshake and then nobody reads: a printer that stalls mid-job.
+    NativeSocket StalledListener(uint16_t* port)
+    {
+        NativeSocket s = socket(AF_INET, SOCK_STREAM, 0);
+        if (s == INVALID_SOCKET) return s;
+        int small = 4096;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&small), sizeof(small));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(s, 1) != 0 ||
+            getsockname(s, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        {
+            CloseSocket(s);
+            return INVALID_SOCKET;
+        }
+        *port = ntohs(addr.sin_port);
+        return s;
+    }
+
+    // A stalled printer fails the write after the timeout instead of
+    // blocking forever; a closed port fails the connect.
+    void SocketTimeout()
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+        uint16_t port = 0;
+        NativeSocket listener = StalledListener(&port);
+        CHECK(listener != INVALID_SOCKET);
+        if (listener == INVALID_SOCKET) return;
+
+        std::string error;
+        auto sink = SocketSink::Connect("127.0.0.1", port, &error, 200);
+        CHECK(sink != nullptr);
+        if (sink)
+        {
+            std::vector<uint8_t> chunk(1 << 20, 0x55);
+            auto start = std::chrono::steady_clock::now();
+            bool ok = true;
+            for (int i = 0; i < 256 && ok; ++i) ok = sink->Write(chunk.data(), chunk.size());
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            CHECK(!ok);
+            CHECK(elapsed < std::chrono::seconds(20));
+        }
+        sink.reset();
+        CloseSocket(listener);
+
+        // Nothing listens on the port now.
+        error.clear();
+        CHECK(SocketSink::Connect("127.0.0.1", port, &error, 200) == nullptr);
+        CHECK(!error.empty());
+    }
+}
+
+int main()
+{
+    struct Case { const char* name; void (*fn)(); };
+    const Case cases[] = {
+        { "color_space", ColorSpace },
+        { "bands_match_sheet", BandsMatchSheet },
+        { "round_trip", RoundTrip },
+        { "roll_round_trip", RollRoundTrip },
+        { "malformed", Malformed },
+        { "socket_round_trip", SocketRoundTrip },
+        { "socket_timeout", SocketTimeout },
+    };
+    for (const auto& c : cases)
+    {
+        int before = g_failures;
+        c.fn();
+        std::printf("%-24s %s\n", c.name, g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+// TaskScheduler and ParallelFor behaviour: priority order, the Background
+// cap, stealing, exception propagation and range coverage.
+//
+// Each case builds its own pool with a fixed worker count and holds workers
+// on gates, so the order of events is forced rather than timed. Waits have
+// generous timeouts so a regression fails instead of hanging.
+
+#include "ParallelFor.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PassportTool::Core;
+
+namespace
+{
+    int g_failures = 0;
+
+#define CHECK(cond)                                                             \
+    do                                                                          \
+    {                                                                           \
+        if (!(cond))                                                            \
+        {                                                                       \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            ++g_failures;                                                       \
+        }                                                                       \
+    } while (0)
+
+    constexpr auto kTimeout = std::chrono::seconds(10);
+
+    // One-shot latch a task can block on.
+    class Gate
+    {
+    public:
+        void Open()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_open = true;
+            }
+            m_cv.notify_all();
+        }
+
+        bool Wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            return m_cv.wait_for(lock, kTimeout, [&] { return m_open; });
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_open{ false };
+    };
+
+    // Polls until pred() holds or the timeout passes.
+    template <typename Pred>
+    bool WaitFor(Pred pred)
+    {
+        auto deadline = std::chrono::steady_clock::now() + kTimeout;
+        while (!pred())
+        {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    // A single busy worker picks queued work by priority, not by arrival.
+    void PriorityOrder()
+    {
+        TaskScheduler pool(1);
+        Gate block;
+        std::atomic<bool> started{ false };
+        pool.Submit(TaskPriority::Normal, [&] { started = true; block.Wait(); });
+        CHECK(WaitFor([&] { return started.load(); }));
+
+        std::mutex mutex;
+        std::vector<std::string> order;
+        auto record = [&](const char* name, TaskPriority expected) {
+            return [&, name, expected] {
+                CHECK(CurrentTaskPriority() == expected);
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(name);
+            };
+        };
+        pool.Submit(TaskPriority::Background, record("background", TaskPriority::Background));
+        pool.Submit(TaskPriority::Normal, record("normal", TaskPriority::Normal));
+        pool.Submit(TaskPriority::Interactive, record("interactive", TaskPriority::Interactive));
+        block.Open();
+
+        CHECK(WaitFor([&] { std::lock_guard<std::mutex> lock(mutex); return order.size() == 3; }));
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(order.size() == 3 && order[0] == "interactive" && order[1] == "normal" && order[2] == "background");
+        CHECK(CurrentTaskPriority() == TaskPriority::Normal);
+    }
+
+    // Background work never takes the last worker, so interactive work
+    // still runs while every Background slot is blocked.
+    void BackgroundCap()
+    {
+        constexpr unsigned kWorkers = 4;
+        std::atomic<int> running{ 0 }, peak{ 0 }, finished{ 0 };
+        Gate release;
+        {
+            TaskScheduler pool(kWorkers);
+            for (int i = 0; i < 6; ++i)
+            {
+                pool.Submit(TaskPriority::Background, [&] {
+                    int now = ++running;
+                    int seen = peak.load();
+                    while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+                    release.Wait();
+                    --running;
+                    ++finished;
+                    });
+            }
+            CHECK(WaitFor([&] { return running.load() == static_cast<int>(kWorkers) - 1; }));
+
+            std::atomic<bool> interactiveRan{ false };
+            pool.Submit(TaskPriority::Interactive, [&] { interactiveRan = true; });
+            CHECK(WaitFor([&] { return interactiveRan.load(); }));
+            CHECK(running.load() == static_cast<int>(kWorkers) - 1);
+
+            release.Open();
+        }   // the destructor runs the remaining Background tasks
+        CHECK(peak.load() == static_cast<int>(kWorkers) - 1);
+        CHECK(finished.load() == 6);
+    }
+
+    // Work a worker spawns lands on its own deque; when that worker is
+    // blocked, the other one must steal it.
+    void Stealing()
+    {
+        TaskScheduler pool(2);
+        std::atomic<int> done{ 0 };
+        std::atomic<bool> parentDone{ false };
+        pool.Submit(TaskPriority::Normal, [&] {
+            for (int i = 0; i < 4; ++i) pool.Submit(TaskPriority::Normal, [&] { ++done; });
+            CHECK(WaitFor([&] { return done.load() == 4; }));   // blocks without helping
+            parentDone = true;
+            });
+        CHECK(WaitFor([&] { return parentDone.load(); }));
+        CHECK(done.load() == 4);
+        CHECK(pool.GetStats().stolen >= 4);
+    }
+
+    // The first exception reaches the ForEach caller after every index ran,
+    // including from nested ForEach calls.
+    void Exceptions()
+    {
+        TaskScheduler pool(3);
+        std::atomic<int> ran{ 0 };
+        bool caught = false;
+        try
+        {
+            pool.ForEach(16, TaskPriority::Normal, [&](int i) {
+                ++ran;
+                if (i == 5) throw std::runtime_error("five");
+                });
+        }
+        catch (const std::runtime_error& e)
+        {
+            caught = std::string(e.what()) == "five";
+        }
+        CHECK(caught);
+        CHECK(ran.load() == 16);
+
+        std::atomic<int> sum{ 0 };
+        pool.ForEach(4, TaskPriority::Interactive, [&](int) {
+            pool.ForEach(4, CurrentTaskPriority(), [&](int j) { sum += j + 1; });
+            });
+        CHECK(sum.load() == 4 * 10);
+
+        caught = false;
+        try
+        {
+            pool.ForEach(4, TaskPriority::Normal, [&](int i) {
+                pool.ForEach(4, TaskPriority::Normal, [&](int j) {
+                    if (i == 2 && j == 3) throw std::logic_error("nested");
+                    });
+                });
+        }
+        catch (const std::logic_error&)
+        {
+            caught = true;
+        }
+        CHECK(caught);
+    }
+
+    // A throwing Background task gives its slot back and leaves the
+    // worker's priority as it was, so later Background work still runs.
+    void BackgroundThrows()
+    {
+        constexpr unsigned kWorkers = 3;
+        TaskScheduler pool(kWorkers);
+        std::atomic<int> thrown{ 0 };
+        for (int i = 0; i < 8; ++i)
+        {
+            pool.Submit(TaskPriority::Background, [&] {
+                ++thrown;
+                throw std::runtime_error("background");
+                });
+        }
+        CHECK(WaitFor([&] { return thrown.load() == 8; }));
+
+        // Every slot must be free again: kWorkers - 1 tasks run at once.
+        std::atomic<int> running{ 0 };
+        Gate release;
+        for (unsigned i = 0; i + 1 < kWorkers; ++i)
+            pool.Submit(TaskPriority::Background, [&] { ++running; release.Wait(); });
+        CHECK(WaitFor([&] { return running.load() == static_cast<int>(kWorkers) - 1; }));
+        release.Open();
+
+        std::atomic<bool> normalRan{ false };
+        pool.Submit(TaskPriority::Normal, [&] {
+            CHECK(CurrentTaskPriority() == TaskPriority::Normal);
+            normalRan = true;
+            });
+        CHECK(WaitFor([&] { return normalRan.load(); }));
+    }
+
+    // Every index is visited exactly once, whatever the chunking.
+    void ParallelForCoverage()
+    {
+        for (int count : { 0, 1, 7, 100, 1000 })
+            for (int minPerTask : { 1, 3, 64, 5000 })
+            {
+                std::vector<std::atomic<int>> hits(static_cast<size_t>(count));
+                ParallelFor(count, minPerTask, [&](int b, int e) {
+                    for (int i = b; i < e; ++i) ++hits[static_cast<size_t>(i)];
+                    });
+                bool once = true;
+                for (auto& h : hits) once = once && h.load() == 1;
+                CHECK(once);
+            }
+    }
+}
+
+int main()
+{
+    struct Case { const char* name; void (*fn)(); };
+    const Case cases[] = {
+        { "priority_order", PriorityOrder },
+        { "background_cap", BackgroundCap },
+        { "stealing", Stealing },
+        { "exceptions", Exceptions },
+        { "background_throws", BackgroundThrows },
+        { "parallel_for_coverage", ParallelForCoverage },
+    };
+    for (const auto& c : cases)
+    {
+        int before = g_failures;
+        c.fn();
+        std::printf("%-24s %s\n", c.name, g_failures == before ? "ok" : "FAILED");
+    }
+    return g_failures == 0 ? 0 : 1;
+}
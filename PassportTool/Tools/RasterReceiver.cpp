@@ -0,0 +1,222 @@
+// Stand-in for a raw-port printer, for testing direct-to-printer output
+// without hardware.
+//
+//   raster_receiver [--port=9100] [--once] [--out=dir]   listen for jobs
+//   raster_receiver --file=job.pwg [--out=dir]            check a saved job
+//   raster_receiver --send=host:port [--urf]              stream a test sheet
+//
+// Each received job is decoded, summarised on stdout and, with --out, written
+// as one PPM per page.
+
+#include "Layout.h"
+#include "Raster.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using NativeSocket = SOCKET;
+static void CloseSocket(NativeSocket s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using NativeSocket = int;
+static constexpr NativeSocket INVALID_SOCKET = -1;
+static void CloseSocket(NativeSocket s) { ::close(s); }
+#endif
+
+using namespace PassportTool::Core;
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct Options
+    {
+        int port{ 9100 };
+        bool once{ false };
+        std::string file;
+        std::string out;
+        std::string send;
+        bool urf{ false };
+    };
+
+    bool Report(const std::vector<uint8_t>& job, const Options& opt, int jobIndex)
+    {
+        std::string error;
+        auto pages = DecodeRaster(job.data(), job.size(), &error);
+        if (!pages)
+        {
+            std::printf("job %d: %zu bytes, rejected: %s\n", jobIndex, job.size(), error.c_str());
+            return false;
+        }
+
+        uint64_t raw = 0;
+        for (const auto& p : *pages) raw += p.rgb.size();
+        std::printf("job %d: %s, %zu page(s), %zu bytes (%.1fx smaller than raw)\n", jobIndex,
+            job[0] == 'R' ? "PWG" : "URF", pages->size(), job.size(),
+            job.empty() ? 0.0 : static_cast<double>(raw) / job.size());
+
+        for (size_t i = 0; i < pages->size(); ++i)
+        {
+            const auto& p = (*pages)[i];
+            std::printf("  page %zu: %d x %d px at %d dpi, %s\n", i + 1, p.width, p.height, p.dpi,
+                p.color == RasterColor::DeviceRgb ? "device RGB" : "sRGB");
+            if (opt.out.empty()) continue;
+            fs::create_directories(opt.out);
+            auto path = fs::path(opt.out) / ("job" + std::to_string(jobIndex) + "-page" + std::to_string(i + 1) + ".ppm");
+            std::ofstream f(path, std::ios::binary);
+            f << "P6\n" << p.width << ' ' << p.height << "\n255\n";
+            f.write(reinterpret_cast<const char*>(p.rgb.data()), static_cast<std::streamsize>(p.rgb.size()));
+        }
+        std::fflush(stdout);
+        return true;
+    }
+
+    int Listen(const Options& opt)
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+#endif
+        NativeSocket server = socket(AF_INET, SOCK_STREAM, 0);
+        if (server == INVALID_SOCKET) return 1;
+        int yes = 1;
+        setsockopt(server, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+        if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(server, 4) != 0)
+        {
+            std::fprintf(stderr, "cannot listen on 127.0.0.1:%d\n", opt.port);
+            CloseSocket(server);
+            return 1;
+        }
+        std::printf("listening on 127.0.0.1:%d\n", opt.port);
+        std::fflush(stdout);
+
+        bool ok = true;
+        for (int jobIndex = 1;; ++jobIndex)
+        {
+            NativeSocket client = accept(server, nullptr, nullptr);
+            if (client == INVALID_SOCKET) break;
+            std::vector<uint8_t> job;
+            char buf[64 * 1024];
+            for (;;)
+            {
+                int n = static_cast<int>(recv(client, buf, sizeof(buf), 0));
+                if (n <= 0) break;
+                job.insert(job.end(), buf, buf + n);
+            }
+            CloseSocket(client);
+            ok = Report(job, opt, jobIndex);
+            if (opt.once) break;
+        }
+        CloseSocket(server);
+        return ok ? 0 : 1;
+    }
+
+    // Synthetic stamp: a vertical gradient with a dark frame, enough to
+    // exercise both literal and repeat runs.
+    PixelBuffer TestStamp(int w, int h)
+    {
+        PixelBuffer b(w, h);
+        for (int y = 0; y < h; ++y)
+        {
+            uint8_t* row = b.Row(y);
+            for (int x = 0; x < w; ++x)
+            {
+                bool frame = x < 4 || y < 4 || x >= w - 4 || y >= h - 4;
+                row[x * 4 + 0] = frame ? 40 : static_cast<uint8_t>(255 * y / h);
+                row[x * 4 + 1] = frame ? 40 : static_cast<uint8_t>((x * 7 + y) & 255);
+                row[x * 4 + 2] = frame ? 40 : 200;
+                row[x * 4 + 3] = 255;
+            }
+        }
+        return b;
+    }
+
+    PixelBuffer Rotate(const PixelBuffer& src)
+    {
+        PixelBuffer dst(src.height, src.width);
+        for (int y = 0; y < src.height; ++y)
+            for (int x = 0; x < src.width; ++x)
+                std::memcpy(dst.Row(x) + (src.height - 1 - y) * 4, src.Row(y) + x * 4, 4);
+        return dst;
+    }
+
+    int Send(const Options& opt)
+    {
+        std::string host;
+        uint16_t port = 0;
+        if (!ParseHostPort(opt.send, &host, &port))
+        {
+            std::fprintf(stderr, "bad address: %s\n", opt.send.c_str());
+            return 2;
+        }
+        std::string error;
+        auto sink = SocketSink::Connect(host, port, &error);
+        if (!sink)
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        auto layout = CalculateOptimalPlacement(6, 4, 1.378, 1.772, 0.05, 300);
+        PixelBuffer stamp = TestStamp(layout.metrics.cellW, layout.metrics.cellH);
+        bool ok = StreamSheet(layout, stamp, Rotate(stamp), opt.urf ? RasterFormat::Urf : RasterFormat::Pwg,
+            RasterColor::Srgb, 300, *sink);
+        std::printf("sent %zu stamps: %s\n", layout.placements.size(), ok ? "ok" : "failed");
+        return ok ? 0 : 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        if (a.rfind("--port=", 0) == 0) opt.port = std::atoi(a.c_str() + 7);
+        else if (a == "--once") opt.once = true;
+        else if (a.rfind("--file=", 0) == 0) opt.file = a.substr(7);
+        else if (a.rfind("--out=", 0) == 0) opt.out = a.substr(6);
+        else if (a.rfind("--send=", 0) == 0) opt.send = a.substr(7);
+        else if (a == "--urf") opt.urf = true;
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--port=N] [--once] [--out=dir] | --file=job.pwg [--out=dir] | --send=host:port [--urf]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!opt.send.empty()) return Send(opt);
+    if (!opt.file.empty())
+    {
+        std::ifstream f(opt.file, std::ios::binary);
+        if (!f)
+        {
+            std::fprintf(stderr, "cannot read %s\n", opt.file.c_str());
+            return 1;
+        }
+        std::vector<uint8_t> job((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        return Report(job, opt, 1) ? 0 : 1;
+    }
+    return Listen(opt);
+}